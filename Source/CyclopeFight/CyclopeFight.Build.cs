@@ -1,14 +1,17 @@
-// Copyright Epic Games, Inc. All Rights Reserved.
-
-using UnrealBuildTool;
-
-public class CyclopeFight : ModuleRules
-{
-	public CyclopeFight(ReadOnlyTargetRules Target) : base(Target)
-	{
-		PCHUsage = PCHUsageMode.UseExplicitOrSharedPCHs;
-
-		PublicDependencyModuleNames.AddRange(new string[] { "Core", "CoreUObject", "Engine", 
-			"InputCore", "Niagara" });
-	}
-}
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+using UnrealBuildTool;
+
+public class CyclopeFight : ModuleRules
+{
+	public CyclopeFight(ReadOnlyTargetRules Target) : base(Target)
+	{
+		PCHUsage = PCHUsageMode.UseExplicitOrSharedPCHs;
+
+		PublicDependencyModuleNames.AddRange(new string[] { "Core", "CoreUObject", "Engine", 
+			"InputCore", "Niagara", "UMG", "Slate", "SlateCore", "PacketHandler" });
+
+		// Spectator replay listing
+		PrivateDependencyModuleNames.AddRange(new string[] { "NetworkReplayStreaming" });
+	}
+}
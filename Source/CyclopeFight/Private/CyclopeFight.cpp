@@ -1,8 +1,46 @@
-// Copyright Epic Games, Inc. All Rights Reserved.
-
-#include "CyclopeFight.h"
-#include "Modules/ModuleManager.h"
-
-IMPLEMENT_PRIMARY_GAME_MODULE( FDefaultGameModuleImpl, CyclopeFight, "CyclopeFight" );
-
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+#include "CyclopeFight.h"
+#include "CoreGlobals.h"
+#include "Misc/ConfigCacheIni.h"
+#include "Modules/ModuleManager.h"
+#include "Memory/CyclopeAllocTracker.h"
+#include "Net/CyclopePacketStatsComponent.h"
+
+/** The game module doubles as the factory for the packet stats handler component **/
+class FCyclopeFightModule : public FPacketHandlerComponentModuleInterface
+{
+public:
+	virtual void StartupModule() override
+	{
+		FPacketHandlerComponentModuleInterface::StartupModule();
+
+		// Early enough to count every allocation of the match, read straight from the
+		// config since the subsystem holding the setting does not exist yet. Only games
+		// play matches, the editor, cooks and other commandlets stay on the plain allocator
+#if !UE_BUILD_SHIPPING
+		bool bTrackAllocations = false;
+		GConfig->GetBool(TEXT("/Script/CyclopeFight.CyclopeMemoryBudgetSubsystem"), TEXT("bTrackAllocations"),
+		                 bTrackAllocations, GGameIni);
+		if (bTrackAllocations && !GIsEditor && !IsRunningCommandlet())
+		{
+			FCyclopeAllocTracker::Install();
+		}
+#endif
+	}
+
+	virtual TSharedPtr<HandlerComponent> CreateComponentInstance(FString& Options) override
+	{
+		const auto Stage = Options == TEXT("Wire") ? ECyclopePacketStatsStage::Wire : ECyclopePacketStatsStage::Raw;
+		return MakeShareable(new FCyclopePacketStatsComponent(Stage));
+	}
+
+	virtual bool IsGameModule() const override
+	{
+		return true;
+	}
+};
+
+IMPLEMENT_PRIMARY_GAME_MODULE( FCyclopeFightModule, CyclopeFight, "CyclopeFight" );
+
 DEFINE_LOG_CATEGORY(LogCyclope)
\ No newline at end of file
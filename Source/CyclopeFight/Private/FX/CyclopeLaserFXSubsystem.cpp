@@ -0,0 +1,215 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "FX/CyclopeLaserFXSubsystem.h"
+
+#include "CyclopeFight.h"
+#include "Memory/CyclopeAllocTracker.h"
+#include "Engine/Engine.h"
+#include "GameFramework/PlayerController.h"
+#include "Camera/PlayerCameraManager.h"
+#include "NiagaraComponent.h"
+#include "NiagaraFunctionLibrary.h"
+#include "Scalability.h"
+
+DECLARE_CYCLE_STAT(TEXT("Laser FX significance"), STAT_CyclopeLaserFXTick, STATGROUP_Cyclope);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Laser beams requested"), STAT_CyclopeBeamsRequested, STATGROUP_Cyclope);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Laser beams culled"), STAT_CyclopeBeamsCulled, STATGROUP_Cyclope);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Laser beams spawned low"), STAT_CyclopeBeamsLow, STATGROUP_Cyclope);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Laser beams active"), STAT_CyclopeBeamsActive, STATGROUP_Cyclope);
+
+UCyclopeLaserFXSubsystem::UCyclopeLaserFXSubsystem()
+{
+	MaxActiveBeamsPerQuality = {4, 8, 16, 32};
+	MaxSpawnsPerFrame = 8;
+	MaxBeamDistance = 10000.f;
+	LowSignificanceThreshold = 0.35f;
+	OffScreenScale = 0.2f;
+}
+
+bool UCyclopeLaserFXSubsystem::ShouldCreateSubsystem(UObject* Outer) const
+{
+	// Nothing renders on a dedicated server
+#if UE_SERVER
+	return false;
+#else
+	return !IsRunningDedicatedServer() && Super::ShouldCreateSubsystem(Outer);
+#endif
+}
+
+void UCyclopeLaserFXSubsystem::Deinitialize()
+{
+	PendingBeams.Empty();
+	ActiveBeams.Empty();
+
+	Super::Deinitialize();
+}
+
+ETickableTickType UCyclopeLaserFXSubsystem::GetTickableTickType() const
+{
+	return HasAnyFlags(RF_ClassDefaultObject) ? ETickableTickType::Never : ETickableTickType::Conditional;
+}
+
+bool UCyclopeLaserFXSubsystem::IsTickable() const
+{
+	return PendingBeams.Num() > 0 || ActiveBeams.Num() > 0;
+}
+
+TStatId UCyclopeLaserFXSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UCyclopeLaserFXSubsystem, STATGROUP_Tickables);
+}
+
+UWorld* UCyclopeLaserFXSubsystem::GetTickableGameObjectWorld() const
+{
+	return GetWorld();
+}
+
+void UCyclopeLaserFXSubsystem::RequestBeam(UNiagaraSystem* System, UNiagaraSystem* LowSystem, const FVector& Origin,
+	const FVector& End, bool bLocallyFired)
+{
+	if (!System)
+	{
+		return;
+	}
+
+	INC_DWORD_STAT(STAT_CyclopeBeamsRequested);
+
+	FLaserBeamRequest Request;
+	Request.System = System;
+	Request.LowSystem = LowSystem;
+	Request.Origin = Origin;
+	Request.End = End;
+	Request.bLocallyFired = bLocallyFired;
+
+	PendingBeams.Add(Request);
+}
+
+void UCyclopeLaserFXSubsystem::Tick(float DeltaTime)
+{
+	SCOPE_CYCLE_COUNTER(STAT_CyclopeLaserFXTick);
+	CYCLOPE_SCOPE_ALLOCS();
+
+	ActiveBeams.RemoveAllSwap([](const TWeakObjectPtr<UNiagaraComponent>& Beam)
+	{
+		return !Beam.IsValid() || !Beam->IsActive();
+	});
+
+	if (PendingBeams.Num() == 0)
+	{
+		SET_DWORD_STAT(STAT_CyclopeBeamsActive, ActiveBeams.Num());
+		return;
+	}
+
+	const auto LocalPC = GEngine->GetFirstLocalPlayerController(GetWorld());
+	FVector ViewLocation{FVector::ZeroVector};
+	FRotator ViewRotation{FRotator::ZeroRotator};
+	float CosHalfFOV = 0.f;
+	if (LocalPC)
+	{
+		LocalPC->GetPlayerViewPoint(ViewLocation, ViewRotation);
+		if (LocalPC->PlayerCameraManager)
+		{
+			CosHalfFOV = FMath::Cos(FMath::DegreesToRadians(LocalPC->PlayerCameraManager->GetFOVAngle() * 0.5f));
+		}
+	}
+	const FVector ViewDir = ViewRotation.Vector();
+
+	for (auto& Request : PendingBeams)
+	{
+		Request.Significance = LocalPC ? ComputeSignificance(Request, ViewLocation, ViewDir, CosHalfFOV) : 1.f;
+	}
+
+	PendingBeams.Sort([](const FLaserBeamRequest& A, const FLaserBeamRequest& B)
+	{
+		return A.Significance > B.Significance;
+	});
+
+	const int32 FreeSlots = FMath::Max(0, GetMaxActiveBeams() - ActiveBeams.Num());
+	const int32 NumToSpawn = FMath::Min3(PendingBeams.Num(), FreeSlots, MaxSpawnsPerFrame);
+
+	for (int32 Idx = 0; Idx < PendingBeams.Num(); ++Idx)
+	{
+		const auto& Request = PendingBeams[Idx];
+		const bool bWithinBudget = Idx < NumToSpawn || Request.bLocallyFired;
+
+		if (!bWithinBudget || Request.Significance <= 0.f)
+		{
+			INC_DWORD_STAT(STAT_CyclopeBeamsCulled);
+			continue;
+		}
+
+		auto System = Request.System;
+		if (Request.Significance < LowSignificanceThreshold && !Request.bLocallyFired)
+		{
+			if (!Request.LowSystem)
+			{
+				INC_DWORD_STAT(STAT_CyclopeBeamsCulled);
+				continue;
+			}
+			System = Request.LowSystem;
+			INC_DWORD_STAT(STAT_CyclopeBeamsLow);
+		}
+
+		if (auto Beam = SpawnBeam(System, Request))
+		{
+			ActiveBeams.Add(Beam);
+		}
+	}
+
+	PendingBeams.Reset();
+	SET_DWORD_STAT(STAT_CyclopeBeamsActive, ActiveBeams.Num());
+}
+
+float UCyclopeLaserFXSubsystem::ComputeSignificance(const FLaserBeamRequest& Request, const FVector& ViewLocation,
+	const FVector& ViewDir, float CosHalfFOV) const
+{
+	if (Request.bLocallyFired)
+	{
+		return 1.f;
+	}
+
+	const FVector Closest = FMath::ClosestPointOnSegment(ViewLocation, Request.Origin, Request.End);
+	const float Distance = FVector::Dist(Closest, ViewLocation);
+	if (Distance > MaxBeamDistance)
+	{
+		return 0.f;
+	}
+
+	// A beam is on screen if any of its ends, middle or closest point is inside the view cone
+	bool bOnScreen = false;
+	const FVector Samples[] = {Closest, Request.Origin, Request.End, (Request.Origin + Request.End) * 0.5f};
+	for (const auto& Sample : Samples)
+	{
+		if (FVector::DotProduct((Sample - ViewLocation).GetSafeNormal(), ViewDir) >= CosHalfFOV)
+		{
+			bOnScreen = true;
+			break;
+		}
+	}
+
+	const float DistanceFactor = 1.f - Distance / MaxBeamDistance;
+	return bOnScreen ? DistanceFactor : DistanceFactor * OffScreenScale;
+}
+
+int32 UCyclopeLaserFXSubsystem::GetMaxActiveBeams() const
+{
+	if (MaxActiveBeamsPerQuality.Num() == 0)
+	{
+		return MAX_int32;
+	}
+
+	const int32 Quality = Scalability::GetQualityLevels().EffectsQuality;
+	return MaxActiveBeamsPerQuality[FMath::Clamp(Quality, 0, MaxActiveBeamsPerQuality.Num() - 1)];
+}
+
+UNiagaraComponent* UCyclopeLaserFXSubsystem::SpawnBeam(UNiagaraSystem* System, const FLaserBeamRequest& Request) const
+{
+	auto LaserBeamComp = UNiagaraFunctionLibrary::SpawnSystemAtLocation(GetWorld(), System, Request.Origin);
+	if (LaserBeamComp)
+	{
+		LaserBeamComp->SetVectorParameter(FName("LaserEnd"), Request.End);
+	}
+
+	return LaserBeamComp;
+}
@@ -0,0 +1,274 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "Game/CyclopeArenaStreamingSubsystem.h"
+
+#include "CyclopeFight.h"
+#include "Engine/Engine.h"
+#include "Engine/LevelStreaming.h"
+#include "Engine/NetConnection.h"
+#include "GameFramework/PlayerController.h"
+#include "HAL/PlatformMemory.h"
+#include "Misc/FileHelper.h"
+#include "Misc/PackageName.h"
+#include "Misc/Paths.h"
+
+DECLARE_CYCLE_STAT(TEXT("Arena streaming"), STAT_CyclopeArenaStreaming, STATGROUP_Cyclope);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Arena cells visible"), STAT_CyclopeCellsVisible, STATGROUP_Cyclope);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Arena cells streaming"), STAT_CyclopeCellsStreaming, STATGROUP_Cyclope);
+
+UCyclopeArenaStreamingSubsystem::UCyclopeArenaStreamingSubsystem()
+{
+	CellSize = 10000.f;
+	LoadRadius = 12000.f;
+	UnloadRadius = 16000.f;
+	UpdateInterval = 0.25f;
+	HitchThresholdMs = 50.f;
+
+	bCellsGathered = false;
+	UpdateCooldown = 0.f;
+}
+
+void UCyclopeArenaStreamingSubsystem::Deinitialize()
+{
+	if (!HasAnyFlags(RF_ClassDefaultObject) && ReportRows.Num() > 0)
+	{
+		WriteReport();
+	}
+
+	Cells.Empty();
+	CellIndices.Empty();
+
+	Super::Deinitialize();
+}
+
+ETickableTickType UCyclopeArenaStreamingSubsystem::GetTickableTickType() const
+{
+	return HasAnyFlags(RF_ClassDefaultObject) ? ETickableTickType::Never : ETickableTickType::Always;
+}
+
+TStatId UCyclopeArenaStreamingSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UCyclopeArenaStreamingSubsystem, STATGROUP_Tickables);
+}
+
+UWorld* UCyclopeArenaStreamingSubsystem::GetTickableGameObjectWorld() const
+{
+	return GetWorld();
+}
+
+bool UCyclopeArenaStreamingSubsystem::IsCellLevel(const ULevelStreaming* Level)
+{
+	return Level && FPackageName::GetShortName(Level->GetWorldAssetPackageName()).Contains(TEXT("_Cell_"));
+}
+
+FIntPoint UCyclopeArenaStreamingSubsystem::GetCellCoord(const FVector& Location) const
+{
+	return FIntPoint(FMath::FloorToInt(Location.X / CellSize), FMath::FloorToInt(Location.Y / CellSize));
+}
+
+void UCyclopeArenaStreamingSubsystem::GatherCells()
+{
+	bCellsGathered = true;
+
+	for (const auto Level : GetWorld()->GetStreamingLevels())
+	{
+		if (!Level)
+		{
+			continue;
+		}
+
+		// <Anything>_Cell_<X>_<Y>, PIE prefixes do not matter
+		const FString ShortName = FPackageName::GetShortName(Level->GetWorldAssetPackageName());
+		FString CoordString;
+		if (!ShortName.Split(TEXT("_Cell_"), nullptr, &CoordString, ESearchCase::IgnoreCase, ESearchDir::FromEnd))
+		{
+			continue;
+		}
+
+		FString XString, YString;
+		if (!CoordString.Split(TEXT("_"), &XString, &YString) || !XString.IsNumeric() || !YString.IsNumeric())
+		{
+			UE_LOG(LogCyclope, Warning, TEXT("Arena streaming: cannot read the cell of %s"), *ShortName);
+			continue;
+		}
+
+		FCyclopeArenaCell Cell;
+		Cell.Level = Level;
+		Cell.Coord = FIntPoint(FCString::Atoi(*XString), FCString::Atoi(*YString));
+		Cell.Bounds = FBox(FVector(Cell.Coord.X * CellSize, Cell.Coord.Y * CellSize, -HALF_WORLD_MAX),
+		                   FVector((Cell.Coord.X + 1) * CellSize, (Cell.Coord.Y + 1) * CellSize, HALF_WORLD_MAX));
+		Cell.bWantLoaded = Level->ShouldBeLoaded();
+
+		CellIndices.Add(Cell.Coord, Cells.Add(Cell));
+	}
+
+	if (Cells.Num() == 0)
+	{
+		return;
+	}
+
+	UE_LOG(LogCyclope, Log, TEXT("Arena streaming: %d cells of %.0f units"), Cells.Num(), CellSize);
+
+	// The server simulates the whole arena
+	if (GetWorld()->GetNetMode() == NM_DedicatedServer || GetWorld()->GetNetMode() == NM_ListenServer)
+	{
+		for (auto& Cell : Cells)
+		{
+			RequestCell(Cell, true);
+		}
+	}
+}
+
+void UCyclopeArenaStreamingSubsystem::Tick(float DeltaTime)
+{
+	SCOPE_CYCLE_COUNTER(STAT_CyclopeArenaStreaming);
+
+	if (!GetWorld() || !GetWorld()->HasBegunPlay())
+	{
+		return;
+	}
+
+	if (!bCellsGathered)
+	{
+		GatherCells();
+	}
+
+	if (Cells.Num() == 0)
+	{
+		return;
+	}
+
+	if (GetWorld()->GetNetMode() == NM_Client || GetWorld()->GetNetMode() == NM_Standalone)
+	{
+		UpdateCooldown -= DeltaTime;
+		if (UpdateCooldown <= 0.f)
+		{
+			UpdateCooldown = UpdateInterval;
+			UpdateWantedCells();
+		}
+	}
+
+	UpdatePendingCells(DeltaTime);
+}
+
+void UCyclopeArenaStreamingSubsystem::UpdateWantedCells()
+{
+	const auto LocalPC = GEngine->GetFirstLocalPlayerController(GetWorld());
+	if (!LocalPC)
+	{
+		return;
+	}
+
+	FVector ViewLocation;
+	FRotator ViewRotation;
+	LocalPC->GetPlayerViewPoint(ViewLocation, ViewRotation);
+
+	for (auto& Cell : Cells)
+	{
+		// The level is the authority on what is loaded, whoever asked for it
+		const auto Level = Cell.Level.Get();
+		if (Level && Cell.RequestTime < 0.0)
+		{
+			Cell.bWantLoaded = Level->ShouldBeLoaded() || Level->IsLevelLoaded();
+		}
+
+		const float DistSq = Cell.Bounds.ComputeSquaredDistanceToPoint(ViewLocation);
+		if (!Cell.bWantLoaded && DistSq <= FMath::Square(LoadRadius))
+		{
+			RequestCell(Cell, true);
+		}
+		else if (Cell.bWantLoaded && DistSq >= FMath::Square(UnloadRadius))
+		{
+			RequestCell(Cell, false);
+		}
+	}
+}
+
+void UCyclopeArenaStreamingSubsystem::RequestCell(FCyclopeArenaCell& Cell, bool bLoad)
+{
+	const auto Level = Cell.Level.Get();
+	if (!Level)
+	{
+		return;
+	}
+
+	Cell.bWantLoaded = bLoad;
+	Cell.RequestTime = FPlatformTime::Seconds();
+	Cell.WorstFrameMs = 0.f;
+	Cell.HitchFrames = 0;
+
+	// Becoming visible makes the player controller tell the server, which then starts
+	// replicating the actors of this cell to us
+	Level->SetShouldBeLoaded(bLoad);
+	Level->SetShouldBeVisible(bLoad);
+}
+
+void UCyclopeArenaStreamingSubsystem::UpdatePendingCells(float DeltaTime)
+{
+	const float FrameMs = DeltaTime * 1000.f;
+	int32 NumVisible = 0;
+	int32 NumStreaming = 0;
+
+	for (auto& Cell : Cells)
+	{
+		const auto Level = Cell.Level.Get();
+		if (!Level)
+		{
+			continue;
+		}
+
+		NumVisible += Level->IsLevelVisible() ? 1 : 0;
+
+		if (Cell.RequestTime < 0.0)
+		{
+			continue;
+		}
+
+		const bool bSettled = Cell.bWantLoaded ? Level->IsLevelVisible() : !Level->IsLevelLoaded();
+		if (!bSettled)
+		{
+			NumStreaming++;
+			Cell.WorstFrameMs = FMath::Max(Cell.WorstFrameMs, FrameMs);
+			Cell.HitchFrames += FrameMs > HitchThresholdMs ? 1 : 0;
+			continue;
+		}
+
+		const double DurationMs = (FPlatformTime::Seconds() - Cell.RequestTime) * 1000.0;
+		const double ResidentMiB = FPlatformMemory::GetStats().UsedPhysical / 1048576.0;
+		const TCHAR* Event = Cell.bWantLoaded ? TEXT("Load") : TEXT("Unload");
+
+		UE_LOG(LogCyclope, Log, TEXT("Arena streaming: %s cell %d,%d in %.0fms, worst frame %.1fms, %d hitches, %.1f MiB resident"),
+		       Event, Cell.Coord.X, Cell.Coord.Y, DurationMs, Cell.WorstFrameMs, Cell.HitchFrames, ResidentMiB);
+		ReportRows.Add(FString::Printf(TEXT("%d,%d,%s,%.0f,%.1f,%d,%.1f"), Cell.Coord.X, Cell.Coord.Y, Event,
+		                               DurationMs, Cell.WorstFrameMs, Cell.HitchFrames, ResidentMiB));
+
+		Cell.RequestTime = -1.0;
+	}
+
+	SET_DWORD_STAT(STAT_CyclopeCellsVisible, NumVisible);
+	SET_DWORD_STAT(STAT_CyclopeCellsStreaming, NumStreaming);
+}
+
+bool UCyclopeArenaStreamingSubsystem::IsLocationLoadedFor(const FVector& Location,
+	const UNetConnection* Connection) const
+{
+	const auto Index = CellIndices.Find(GetCellCoord(Location));
+	const auto Level = Index ? Cells[*Index].Level.Get() : nullptr;
+	if (!Level || !Connection)
+	{
+		return true;
+	}
+
+	// Kept up to date by the engine from the client's level visibility notifications
+	return Connection->ClientVisibleLevelNames.Contains(Level->GetWorldAssetPackageFName());
+}
+
+void UCyclopeArenaStreamingSubsystem::WriteReport() const
+{
+	const FString Csv = TEXT("CellX,CellY,Event,DurationMs,WorstFrameMs,HitchFrames,ResidentMiB\n") +
+		FString::Join(ReportRows, TEXT("\n")) + TEXT("\n");
+
+	const FString FileName = FString::Printf(TEXT("Streaming_%d.csv"), FPlatformProcess::GetCurrentProcessId());
+	FFileHelper::SaveStringToFile(Csv, *FPaths::Combine(FPaths::ProjectSavedDir(), TEXT("Benchmarks"), FileName));
+}
@@ -0,0 +1,216 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "Game/CyclopeAssetPreloadSubsystem.h"
+
+#include "CyclopeFight.h"
+#include "Engine/AssetManager.h"
+#include "Engine/StreamableManager.h"
+#include "GameFramework/HUD.h"
+#include "HAL/PlatformProperties.h"
+#include "Player/CyclopeFightCharacter.h"
+#include "ProfilingDebugging/MiscTrace.h"
+#include "UObject/UObjectGlobals.h"
+
+namespace
+{
+	double SecondsSinceProcessStart()
+	{
+		return FPlatformTime::Seconds() - GStartTime;
+	}
+}
+
+UCyclopeAssetPreloadSubsystem::UCyclopeAssetPreloadSubsystem()
+{
+	CharacterClass = TSoftClassPtr<APawn>(FSoftObjectPath(TEXT("/Game/Blueprints/CyclopeCharacter.CyclopeCharacter_C")));
+
+	PreloadStartTime = -1.0;
+	PreloadEndTime = -1.0;
+	MapLoadedTime = -1.0;
+	ReadyTime = -1.0;
+}
+
+void UCyclopeAssetPreloadSubsystem::Initialize(FSubsystemCollectionBase& Collection)
+{
+	Super::Initialize(Collection);
+
+	PostLoadMapHandle = FCoreUObjectDelegates::PostLoadMapWithWorld.AddUObject(this,
+		&UCyclopeAssetPreloadSubsystem::OnPostLoadMap);
+
+	// The game instance is up before the first map load starts, so the requests overlap with it
+	PreloadStartTime = SecondsSinceProcessStart();
+	TRACE_BOOKMARK(TEXT("Cyclope preload started"));
+
+	CharacterHandle = UAssetManager::GetStreamableManager().RequestAsyncLoad(CharacterClass.ToSoftObjectPath(),
+		FStreamableDelegate::CreateUObject(this, &UCyclopeAssetPreloadSubsystem::OnCharacterClassLoaded),
+		FStreamableManager::AsyncLoadHighPriority);
+	if (!CharacterHandle.IsValid())
+	{
+		OnCharacterClassLoaded();
+	}
+}
+
+void UCyclopeAssetPreloadSubsystem::Deinitialize()
+{
+	FCoreUObjectDelegates::PostLoadMapWithWorld.Remove(PostLoadMapHandle);
+
+	if (CharacterHandle.IsValid())
+	{
+		CharacterHandle->CancelHandle();
+	}
+	if (ClientAssetsHandle.IsValid())
+	{
+		ClientAssetsHandle->CancelHandle();
+	}
+
+	Super::Deinitialize();
+}
+
+bool UCyclopeAssetPreloadSubsystem::WantsClientAssets() const
+{
+#if UE_SERVER
+	return false;
+#else
+	return !IsRunningDedicatedServer();
+#endif
+}
+
+UClass* UCyclopeAssetPreloadSubsystem::GetCharacterClass()
+{
+	if (!CharacterClass.IsValid() && !CharacterClass.IsNull())
+	{
+		UE_LOG(LogCyclope, Warning, TEXT("Character class requested before the preload finished, loading it now"));
+		CharacterClass.LoadSynchronous();
+	}
+
+	return CharacterClass.Get();
+}
+
+UClass* UCyclopeAssetPreloadSubsystem::GetHUDClass()
+{
+	if (!WantsClientAssets())
+	{
+		return nullptr;
+	}
+
+	if (!HUDClass.IsValid() && !HUDClass.IsNull())
+	{
+		UE_LOG(LogCyclope, Warning, TEXT("HUD class requested before the preload finished, loading it now"));
+		HUDClass.LoadSynchronous();
+	}
+
+	return HUDClass.Get();
+}
+
+void UCyclopeAssetPreloadSubsystem::OnCharacterClassLoaded()
+{
+	TArray<FSoftObjectPath> ClientAssets;
+	if (!WantsClientAssets())
+	{
+		CheckNoClientAssetsLoaded();
+	}
+	else
+	{
+		ClientAssets.Add(HUDClass.ToSoftObjectPath());
+
+		const auto Character = CharacterClass.Get()
+			                       ? Cast<ACyclopeFightCharacter>(CharacterClass.Get()->GetDefaultObject())
+			                       : nullptr;
+		if (Character)
+		{
+			Character->GetClientAssets(ClientAssets);
+		}
+	}
+
+	ClientAssets.RemoveAll([](const FSoftObjectPath& Path)
+	{
+		return Path.IsNull();
+	});
+
+	if (ClientAssets.Num() == 0)
+	{
+		OnPreloadComplete();
+		return;
+	}
+
+	ClientAssetsHandle = UAssetManager::GetStreamableManager().RequestAsyncLoad(ClientAssets,
+		FStreamableDelegate::CreateUObject(this, &UCyclopeAssetPreloadSubsystem::OnPreloadComplete),
+		FStreamableManager::AsyncLoadHighPriority);
+	if (!ClientAssetsHandle.IsValid())
+	{
+		OnPreloadComplete();
+	}
+}
+
+void UCyclopeAssetPreloadSubsystem::CheckNoClientAssetsLoaded() const
+{
+	// Cooking saves CyclopeCharacter again from its loaded class, where the laser systems are soft
+	// references, so cooked packages no longer import them. Uncooked content still has the imports
+	// of the asset as it was last saved, only cooked servers are held to this
+	if (!FPlatformProperties::RequiresCookedData())
+	{
+		return;
+	}
+
+	TArray<FSoftObjectPath> ClientAssets;
+	ClientAssets.Add(HUDClass.ToSoftObjectPath());
+
+	const auto Character = CharacterClass.Get() ? Cast<ACyclopeFightCharacter>(CharacterClass.Get()->GetDefaultObject()) : nullptr;
+	if (Character)
+	{
+		Character->GetClientAssets(ClientAssets);
+	}
+
+	// Nothing asked for these, so if they resolve, a package hard references them again
+	for (const auto& Path : ClientAssets)
+	{
+		if (!Path.IsNull() && Path.ResolveObject())
+		{
+			UE_LOG(LogCyclope, Error,
+			       TEXT("Client only asset %s was loaded on the dedicated server, a package hard references it"),
+			       *Path.ToString());
+			ensureMsgf(false, TEXT("Client only asset %s loaded on the dedicated server"), *Path.ToString());
+		}
+	}
+}
+
+void UCyclopeAssetPreloadSubsystem::OnPreloadComplete()
+{
+	if (PreloadEndTime >= 0.0)
+	{
+		return;
+	}
+
+	PreloadEndTime = SecondsSinceProcessStart();
+	TRACE_BOOKMARK(TEXT("Cyclope preload complete"));
+
+	TryMarkReady();
+}
+
+void UCyclopeAssetPreloadSubsystem::OnPostLoadMap(UWorld* World)
+{
+	if (MapLoadedTime >= 0.0 || !World || World->GetGameInstance() != GetGameInstance())
+	{
+		return;
+	}
+
+	MapLoadedTime = SecondsSinceProcessStart();
+	TRACE_BOOKMARK(TEXT("Cyclope map loaded"));
+
+	TryMarkReady();
+}
+
+void UCyclopeAssetPreloadSubsystem::TryMarkReady()
+{
+	if (ReadyTime >= 0.0 || MapLoadedTime < 0.0 || PreloadEndTime < 0.0)
+	{
+		return;
+	}
+
+	ReadyTime = SecondsSinceProcessStart();
+	TRACE_BOOKMARK(TEXT("Cyclope ready for players"));
+
+	UE_LOG(LogCyclope, Display,
+	       TEXT("Startup: map loaded at %.2fs, assets preloaded at %.2fs (%.0fms async), ready for players at %.2fs"),
+	       MapLoadedTime, PreloadEndTime, (PreloadEndTime - PreloadStartTime) * 1000.0, ReadyTime);
+}
@@ -1,126 +1,366 @@
-// Copyright Epic Games, Inc. All Rights Reserved.
-
-#include "Game/CyclopeFightGameMode.h"
-#include "Player/CyclopeFightCharacter.h"
-#include "Game/CyclopeFightGameState.h"
-#include "Player/CyclopeHUD.h"
-#include "Player/CyclopePlayerController.h"
-#include "EngineUtils.h"
-#include "GameFramework/PlayerStart.h"
-#include "Kismet/GameplayStatics.h"
-#include "UObject/ConstructorHelpers.h"
-
-ACyclopeFightGameMode::ACyclopeFightGameMode()
-{
-	// set default pawn class to our Blueprinted character
-	static ConstructorHelpers::FClassFinder<APawn> PlayerPawnBPClass(
-		TEXT("/Game/Blueprints/CyclopeCharacter"));
-	if (PlayerPawnBPClass.Class)
-	{
-		DefaultPawnClass = PlayerPawnBPClass.Class;
-	}
-
-	static ConstructorHelpers::FClassFinder<AHUD> HUDBPClass(
-		TEXT("/Game/Blueprints/CyclopeHUD_BP"));
-	if(HUDBPClass.Class)
-	{
-		HUDClass = HUDBPClass.Class;	
-	}
-	
-	PlayerControllerClass = ACyclopePlayerController::StaticClass();
-	GameStateClass = ACyclopeFightGameState::StaticClass();
-	
-	CollectedPlayerStarts = false;
-
-	FreeID = 0;
-}
-
-void ACyclopeFightGameMode::BeginPlay()
-{
-	Super::BeginPlay();
-}
-
-APlayerController* ACyclopeFightGameMode::Login(UPlayer* NewPlayer, ENetRole InRemoteRole, const FString& Portal,
-	const FString& Options, const FUniqueNetIdRepl& UniqueId, FString& ErrorMessage)
-{
-	FActorSpawnParameters SpawnInfo;
-	SpawnInfo.Instigator = GetInstigator();
-	SpawnInfo.ObjectFlags |= RF_Transient;
-	SpawnInfo.bDeferConstruction = true;
-	
-	auto NewPC = GetWorld()->SpawnActor<ACyclopePlayerController>(PlayerControllerClass,
-		FVector::ZeroVector, FRotator::ZeroRotator, SpawnInfo);
-
-	if(NewPC)
-	{
-		NewPC->SetPlayerID(FreeID);
-		FreeID++;
-		if(InRemoteRole == ROLE_SimulatedProxy)
-		{
-			NewPC->SetAsLocalPlayerController();
-		}
-		
-		UGameplayStatics::FinishSpawningActor(NewPC,
-			FTransform(FRotator::ZeroRotator, FVector::ZeroVector));
-		
-	}
-	
-	return NewPC; 
-}
-
-AActor* ACyclopeFightGameMode::ChoosePlayerStart_Implementation(AController* Player)
-{
-	if(!CollectedPlayerStarts)
-	{
-		for(TActorIterator<APlayerStart> It(GetWorld()); It; ++It)
-		{
-			PlayerStarts.Add(*It);
-		}
-		CollectedPlayerStarts = true;
-	}
-	
-	AActor* OutPlayerStart{nullptr};
-
-	auto AsCyclopePC = ExactCast<ACyclopePlayerController>(Player);
-	for(const auto& Start : PlayerStarts)
-	{
-		switch (AsCyclopePC->GetPlayerID())
-		{
-		case 0:
-			if(Start->PlayerStartTag == "Player1")
-			{
-				OutPlayerStart = Start;
-				
-			}
-			break;
-
-		case 1:
-			if(Start->PlayerStartTag == "Player2")
-			{
-				OutPlayerStart = Start;
-			}
-			break;			
-		}
-	}
-	
-	return OutPlayerStart;
-}
-
-void ACyclopeFightGameMode::Respawn_Implementation(APlayerController* Player)
-{
-	if(Player)
-	{
-		if(GetLocalRole() == ROLE_Authority)
-		{
-			int32 PlayerStartIdx = FMath::RandBool() ? 0 : 1;
-			auto NewChar = GetWorld()->SpawnActor<ACyclopeFightCharacter>(DefaultPawnClass,
-				PlayerStarts[PlayerStartIdx]->GetActorLocation(), FRotator::ZeroRotator);
-
-			if(NewChar)
-			{
-				Player->Possess(NewChar);
-			}
-		}
-	}
-}
-
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+#include "Game/CyclopeFightGameMode.h"
+#include "CyclopeFight.h"
+#include "Player/CyclopeFightCharacter.h"
+#include "Game/CyclopeArenaStreamingSubsystem.h"
+#include "Game/CyclopeAssetPreloadSubsystem.h"
+#include "Game/CyclopeFightGameState.h"
+#include "Memory/CyclopeAllocTracker.h"
+#include "Player/CyclopeHUD.h"
+#include "Player/CyclopePlayerController.h"
+#include "EngineUtils.h"
+#include "GameFramework/PlayerStart.h"
+#include "HAL/IConsoleManager.h"
+#include "HAL/PlatformMemory.h"
+#include "Engine/ChildConnection.h"
+#include "Engine/GameInstance.h"
+#include "Engine/LevelStreaming.h"
+#include "Engine/LocalPlayer.h"
+#include "Engine/NetDriver.h"
+#include "Kismet/GameplayStatics.h"
+#include "Misc/CommandLine.h"
+#include "Serialization/ArchiveCountMem.h"
+
+static FAutoConsoleCommandWithWorld CyclopeMemReportCommand(
+	TEXT("Cyclope.MemReport"),
+	TEXT("Logs resident memory of the process and UObject memory of every character"),
+	FConsoleCommandWithWorldDelegate::CreateStatic(&ACyclopeFightGameMode::LogMemoryFootprint));
+
+ACyclopeFightGameMode::ACyclopeFightGameMode()
+{
+	// Blueprint classes are loaded asynchronously by UCyclopeAssetPreloadSubsystem. The HUD is swapped
+	// for its Blueprint on the client, so the server never loads it
+	HUDClass = ACyclopeHUD::StaticClass();
+
+	PlayerControllerClass = ACyclopePlayerController::StaticClass();
+	ReplaySpectatorPlayerControllerClass = ACyclopePlayerController::StaticClass();
+	GameStateClass = ACyclopeFightGameState::StaticClass();
+	
+	CollectedPlayerStarts = false;
+
+	FreeID = 0;
+
+	HibernationTickRate = 5;
+	HibernateBelowPlayers = 1;
+	WakeGraceTime = 10.f;
+	bHibernating = false;
+	AwakeTickRate = 0;
+
+	bRecordReplays = false;
+	ReplayName = TEXT("CyclopeMatch");
+}
+
+void ACyclopeFightGameMode::BeginPlay()
+{
+	Super::BeginPlay();
+
+	LogMemoryFootprint(GetWorld());
+
+	UpdateHibernation();
+
+	StartReplayRecording();
+}
+
+void ACyclopeFightGameMode::StartReplayRecording()
+{
+	if(GetNetMode() != NM_DedicatedServer ||
+		!(bRecordReplays || FParse::Param(FCommandLine::Get(), TEXT("CyclopeReplay"))))
+	{
+		return;
+	}
+
+	// The streamer is picked from [NetworkReplayStreaming] and flushes chunks while the match runs
+	UE_LOG(LogCyclope, Log, TEXT("Recording replay %s"), *ReplayName);
+	GetGameInstance()->StartRecordingReplay(ReplayName, GetWorld()->GetMapName());
+}
+
+void ACyclopeFightGameMode::LogMemoryFootprint(UWorld* World)
+{
+	const auto MemStats = FPlatformMemory::GetStats();
+	UE_LOG(LogCyclope, Display, TEXT("Process resident memory: %.1f MiB (peak %.1f MiB)"),
+		MemStats.UsedPhysical / 1048576.0, MemStats.PeakUsedPhysical / 1048576.0);
+
+	if(!World)
+	{
+		return;
+	}
+
+	for(TActorIterator<ACyclopeFightCharacter> It(World); It; ++It)
+	{
+		FArchiveCountMem ActorMem(*It);
+		SIZE_T Bytes = ActorMem.GetMax();
+		int32 NumComponents = 0;
+
+		for(const auto Component : It->GetComponents())
+		{
+			FArchiveCountMem ComponentMem(Component);
+			Bytes += ComponentMem.GetMax();
+			NumComponents++;
+		}
+
+		UE_LOG(LogCyclope, Display, TEXT("%s: %.1f KiB in actor and %d components"), *GetNameSafe(*It),
+			Bytes / 1024.0, NumComponents);
+	}
+}
+
+void ACyclopeFightGameMode::PreLogin(const FString& Options, const FString& Address, const FUniqueNetIdRepl& UniqueId,
+	FString& ErrorMessage)
+{
+	// Wake up as soon as a connection asks to join, so the rest of the handshake runs at full rate
+	if(bHibernating)
+	{
+		ExitHibernation();
+
+		// Go back to sleep if the connection never makes it through Login
+		GetWorldTimerManager().SetTimer(WakeGraceTimer, FTimerDelegate::CreateUObject(this,
+			&ACyclopeFightGameMode::UpdateHibernation, static_cast<AController*>(nullptr)), WakeGraceTime, false);
+	}
+
+	Super::PreLogin(Options, Address, UniqueId, ErrorMessage);
+}
+
+APlayerController* ACyclopeFightGameMode::Login(UPlayer* NewPlayer, ENetRole InRemoteRole, const FString& Portal,
+	const FString& Options, const FUniqueNetIdRepl& UniqueId, FString& ErrorMessage)
+{
+	ExitHibernation();
+
+	FActorSpawnParameters SpawnInfo;
+	SpawnInfo.Instigator = GetInstigator();
+	SpawnInfo.ObjectFlags |= RF_Transient;
+	SpawnInfo.bDeferConstruction = true;
+	
+	auto NewPC = GetWorld()->SpawnActor<ACyclopePlayerController>(PlayerControllerClass,
+		FVector::ZeroVector, FRotator::ZeroRotator, SpawnInfo);
+
+	if(NewPC)
+	{
+		NewPC->SetPlayerID(FreeID);
+		FreeID++;
+		if(InRemoteRole == ROLE_SimulatedProxy)
+		{
+			NewPC->SetAsLocalPlayerController();
+		}
+		
+		UGameplayStatics::FinishSpawningActor(NewPC,
+			FTransform(FRotator::ZeroRotator, FVector::ZeroVector));
+		
+	}
+	
+	return NewPC; 
+}
+
+void ACyclopeFightGameMode::Logout(AController* Exiting)
+{
+	Super::Logout(Exiting);
+
+	UpdateHibernation(Exiting);
+}
+
+void ACyclopeFightGameMode::ReplicateStreamingStatus(APlayerController* PC)
+{
+	if (GetWorld()->GetWorldSettings()->bUseClientSideLevelStreamingVolumes)
+	{
+		Super::ReplicateStreamingStatus(PC);
+		return;
+	}
+
+	// The server keeps every cell loaded, telling clients would make them load the whole arena
+	// and block on it. Local players and splitscreen guests share the server's levels
+	if (Cast<ULocalPlayer>(PC->Player) || Cast<UChildConnection>(PC->Player))
+	{
+		return;
+	}
+
+	TArray<FUpdateLevelStreamingLevelStatus> LevelStatuses;
+	for (const auto Level : GetWorld()->GetStreamingLevels())
+	{
+		if (!Level || UCyclopeArenaStreamingSubsystem::IsCellLevel(Level))
+		{
+			continue;
+		}
+
+		auto& Status = LevelStatuses.AddDefaulted_GetRef();
+		Status.PackageName = PC->NetworkRemapPath(Level->GetWorldAssetPackageFName(), false);
+		Status.bNewShouldBeLoaded = Level->ShouldBeLoaded();
+		Status.bNewShouldBeVisible = Level->ShouldBeVisible();
+		Status.bNewShouldBlockOnLoad = Level->bShouldBlockOnLoad;
+		Status.LODIndex = Level->GetLevelLODIndex();
+	}
+
+	if (LevelStatuses.Num() > 0)
+	{
+		PC->ClientUpdateMultipleLevelsStreamingStatus(LevelStatuses);
+	}
+	PC->ClientFlushLevelStreaming();
+}
+
+void ACyclopeFightGameMode::UpdateHibernation(AController* Exiting)
+{
+	if(GetNetMode() != NM_DedicatedServer)
+	{
+		return;
+	}
+
+	// The replay recorder's spectator is not a player and must not keep the server awake
+	int32 NumConnected = 0;
+	for(auto It = GetWorld()->GetPlayerControllerIterator(); It; ++It)
+	{
+		const auto CyclopePC = Cast<ACyclopePlayerController>(It->Get());
+		if(It->IsValid() && It->Get() != Exiting && !(CyclopePC && CyclopePC->IsReplayRecorder()))
+		{
+			NumConnected++;
+		}
+	}
+
+	if(NumConnected < HibernateBelowPlayers)
+	{
+		EnterHibernation();
+	}
+	else
+	{
+		ExitHibernation();
+	}
+}
+
+void ACyclopeFightGameMode::EnterHibernation()
+{
+	auto NetDriver = GetWorld()->GetNetDriver();
+	if(bHibernating || !NetDriver)
+	{
+		return;
+	}
+
+	bHibernating = true;
+	AwakeTickRate = NetDriver->NetServerMaxTickRate;
+	NetDriver->NetServerMaxTickRate = HibernationTickRate;
+	SuspendPawnTicks();
+
+	UE_LOG(LogCyclope, Log, TEXT("Server hibernating at %d Hz"), HibernationTickRate);
+}
+
+void ACyclopeFightGameMode::ExitHibernation()
+{
+	auto NetDriver = GetWorld()->GetNetDriver();
+	if(!bHibernating || !NetDriver)
+	{
+		return;
+	}
+
+	bHibernating = false;
+	NetDriver->NetServerMaxTickRate = AwakeTickRate;
+	ResumePawnTicks();
+
+	UE_LOG(LogCyclope, Log, TEXT("Server woke up at %d Hz"), AwakeTickRate);
+}
+
+void ACyclopeFightGameMode::SuspendPawnTicks()
+{
+	for(TActorIterator<APawn> It(GetWorld()); It; ++It)
+	{
+		if(It->IsActorTickEnabled())
+		{
+			It->SetActorTickEnabled(false);
+			SuspendedActors.Add(*It);
+		}
+
+		for(const auto Component : It->GetComponents())
+		{
+			if(Component && Component->IsComponentTickEnabled())
+			{
+				Component->SetComponentTickEnabled(false);
+				SuspendedComponents.Add(Component);
+			}
+		}
+	}
+}
+
+void ACyclopeFightGameMode::ResumePawnTicks()
+{
+	for(const auto& Actor : SuspendedActors)
+	{
+		if(Actor.IsValid())
+		{
+			Actor->SetActorTickEnabled(true);
+		}
+	}
+
+	for(const auto& Component : SuspendedComponents)
+	{
+		if(Component.IsValid())
+		{
+			Component->SetComponentTickEnabled(true);
+		}
+	}
+
+	SuspendedActors.Reset();
+	SuspendedComponents.Reset();
+}
+
+UClass* ACyclopeFightGameMode::GetDefaultPawnClassForController_Implementation(AController* InController)
+{
+	auto Preload = GetGameInstance() ? GetGameInstance()->GetSubsystem<UCyclopeAssetPreloadSubsystem>() : nullptr;
+	auto CharacterClass = Preload ? Preload->GetCharacterClass() : nullptr;
+
+	// Respawn spawns an ACyclopeFightCharacter, the engine default pawn would not do
+	return CharacterClass ? CharacterClass : ACyclopeFightCharacter::StaticClass();
+}
+
+AActor* ACyclopeFightGameMode::ChoosePlayerStart_Implementation(AController* Player)
+{
+	if(!CollectedPlayerStarts)
+	{
+		for(TActorIterator<APlayerStart> It(GetWorld()); It; ++It)
+		{
+			PlayerStarts.Add(*It);
+		}
+		CollectedPlayerStarts = true;
+	}
+	
+	AActor* OutPlayerStart{nullptr};
+
+	auto AsCyclopePC = ExactCast<ACyclopePlayerController>(Player);
+	for(const auto& Start : PlayerStarts)
+	{
+		switch (AsCyclopePC->GetPlayerID())
+		{
+		case 0:
+			if(Start->PlayerStartTag == "Player1")
+			{
+				OutPlayerStart = Start;
+				
+			}
+			break;
+
+		case 1:
+			if(Start->PlayerStartTag == "Player2")
+			{
+				OutPlayerStart = Start;
+			}
+			break;			
+		}
+	}
+	
+	return OutPlayerStart;
+}
+
+void ACyclopeFightGameMode::Respawn_Implementation(APlayerController* Player)
+{
+	CYCLOPE_SCOPE_ALLOCS();
+
+	if(Player)
+	{
+		if(GetLocalRole() == ROLE_Authority)
+		{
+			int32 PlayerStartIdx = FMath::RandBool() ? 0 : 1;
+			auto NewChar = GetWorld()->SpawnActor<ACyclopeFightCharacter>(GetDefaultPawnClassForController(Player),
+				PlayerStarts[PlayerStartIdx]->GetActorLocation(), FRotator::ZeroRotator);
+
+			if(NewChar)
+			{
+				Player->Possess(NewChar);
+			}
+		}
+	}
+}
+
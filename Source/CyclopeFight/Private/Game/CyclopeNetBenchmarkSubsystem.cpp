@@ -0,0 +1,395 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "Game/CyclopeNetBenchmarkSubsystem.h"
+
+#include "CyclopeFight.h"
+#include "Components/CapsuleComponent.h"
+#include "Engine/DemoNetDriver.h"
+#include "Engine/Engine.h"
+#include "Engine/NetConnection.h"
+#include "Engine/NetDriver.h"
+#include "EngineUtils.h"
+#include "Game/CyclopeFightGameMode.h"
+#include "Misc/CommandLine.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+#include "Player/CyclopeCharacterMovementComponent.h"
+#include "Player/CyclopeFightCharacter.h"
+#include "Player/CyclopePlayerController.h"
+
+UCyclopeNetBenchmarkSubsystem::UCyclopeNetBenchmarkSubsystem()
+{
+	ShotInterval = 0.5f;
+	AgreeTolerance = 10.f;
+
+	CurrentProfile = 0;
+	NextClaimId = 0;
+	ProfileElapsed = 0.f;
+	ShotCooldown = 0.f;
+	bFinished = false;
+}
+
+bool UCyclopeNetBenchmarkSubsystem::ShouldCreateSubsystem(UObject* Outer) const
+{
+	return FParse::Param(FCommandLine::Get(), TEXT("CyclopeNetBench")) && Super::ShouldCreateSubsystem(Outer);
+}
+
+void UCyclopeNetBenchmarkSubsystem::Deinitialize()
+{
+	if (!HasAnyFlags(RF_ClassDefaultObject) && !bFinished && Results.Num() > 0)
+	{
+		DropPendingClaims();
+		WriteReport(IsServer());
+	}
+
+	Super::Deinitialize();
+}
+
+ETickableTickType UCyclopeNetBenchmarkSubsystem::GetTickableTickType() const
+{
+	return HasAnyFlags(RF_ClassDefaultObject) ? ETickableTickType::Never : ETickableTickType::Always;
+}
+
+TStatId UCyclopeNetBenchmarkSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UCyclopeNetBenchmarkSubsystem, STATGROUP_Tickables);
+}
+
+UWorld* UCyclopeNetBenchmarkSubsystem::GetTickableGameObjectWorld() const
+{
+	return GetWorld();
+}
+
+bool UCyclopeNetBenchmarkSubsystem::IsServer() const
+{
+	return GetWorld() && GetWorld()->GetNetMode() != NM_Client;
+}
+
+void UCyclopeNetBenchmarkSubsystem::Tick(float DeltaTime)
+{
+	if (bFinished || Profiles.Num() == 0 || !GetWorld() || !GetWorld()->HasBegunPlay())
+	{
+		return;
+	}
+
+	if (Results.Num() != Profiles.Num())
+	{
+		Results.SetNum(Profiles.Num());
+		if (IsServer())
+		{
+			ApplyProfile(CurrentProfile);
+		}
+	}
+
+	if (IsServer())
+	{
+		TickServer(DeltaTime);
+	}
+	else
+	{
+		TickClient(DeltaTime);
+	}
+}
+
+void UCyclopeNetBenchmarkSubsystem::TickServer(float DeltaTime)
+{
+	auto NetDriver = GetWorld()->GetNetDriver();
+	if (!NetDriver || NetDriver->ClientConnections.Num() < 2)
+	{
+		// Wait for both players before the clock starts
+		return;
+	}
+
+	auto& Result = Results[CurrentProfile];
+	for (const auto Connection : NetDriver->ClientConnections)
+	{
+		if (Connection)
+		{
+			Result.BytesIn += Connection->InBytesPerSecond * DeltaTime;
+			Result.BytesOut += Connection->OutBytesPerSecond * DeltaTime;
+			Result.PlayerSeconds += DeltaTime;
+		}
+	}
+
+	// Cost of recording the match, compare runs with and without -CyclopeReplay
+	Result.Seconds += DeltaTime;
+	Result.GameThreadMs += FPlatformTime::ToMilliseconds(GGameThreadTime);
+	Result.Frames++;
+	if (const auto DemoDriver = GetWorld()->GetDemoNetDriver())
+	{
+		for (const auto Connection : DemoDriver->ClientConnections)
+		{
+			Result.ReplayBytes += Connection ? Connection->OutBytesPerSecond * DeltaTime : 0.0;
+		}
+	}
+
+	// Keep both players in the fight
+	auto GM = Cast<ACyclopeFightGameMode>(GetWorld()->GetAuthGameMode());
+	for (auto It = GetWorld()->GetPlayerControllerIterator(); GM && It; ++It)
+	{
+		const auto PC = Cast<ACyclopePlayerController>(It->Get());
+		if (PC && !PC->GetPawn() && !PC->IsReplayRecorder())
+		{
+			GM->Respawn(PC);
+		}
+	}
+
+	ProfileElapsed += DeltaTime;
+	if (ProfileElapsed >= Profiles[CurrentProfile].Duration)
+	{
+		CollectPacketStats(CurrentProfile);
+		ProfileElapsed = 0.f;
+		++CurrentProfile;
+
+		if (CurrentProfile >= Profiles.Num())
+		{
+			bFinished = true;
+			WriteReport(true);
+			FPlatformMisc::RequestExit(false);
+			return;
+		}
+
+		ApplyProfile(CurrentProfile);
+	}
+}
+
+void UCyclopeNetBenchmarkSubsystem::TickClient(float DeltaTime)
+{
+	auto LocalPC = GEngine->GetFirstLocalPlayerController(GetWorld());
+	auto LocalChar = LocalPC ? Cast<ACyclopeFightCharacter>(LocalPC->GetPawn()) : nullptr;
+	if (!LocalChar)
+	{
+		return;
+	}
+
+	ShotCooldown -= DeltaTime;
+	if (ShotCooldown > 0.f)
+	{
+		return;
+	}
+
+	for (TActorIterator<ACyclopeFightCharacter> It(GetWorld()); It; ++It)
+	{
+		if (*It != LocalChar && !It->IsHidden())
+		{
+			LocalChar->AimAt(It->GetActorLocation());
+			LocalChar->Shoot();
+
+			Results[CurrentProfile].ShotsFired++;
+			ShotCooldown = ShotInterval;
+			break;
+		}
+	}
+}
+
+void UCyclopeNetBenchmarkSubsystem::OnHitClaimed(const FHitResult& Impact, float TargetTimestamp)
+{
+	auto LocalPC = Cast<ACyclopePlayerController>(GEngine->GetFirstLocalPlayerController(GetWorld()));
+	if (!LocalPC || !Results.IsValidIndex(CurrentProfile))
+	{
+		return;
+	}
+
+	NextClaimId++;
+
+	Results[CurrentProfile].HitsClaimed++;
+	PendingClaims.Add(NextClaimId, FPlatformTime::Seconds());
+	LocalPC->Server_BenchHitClaimed(NextClaimId, Impact, TargetTimestamp);
+}
+
+void UCyclopeNetBenchmarkSubsystem::OnHitConfirmed(uint16 ClaimId, bool bServerAgreed)
+{
+	// Answers to claims already counted as lost when their profile ended
+	double ClaimTime;
+	if (!PendingClaims.RemoveAndCopyValue(ClaimId, ClaimTime) || !Results.IsValidIndex(CurrentProfile))
+	{
+		return;
+	}
+
+	auto& Result = Results[CurrentProfile];
+	Result.HitsConfirmed++;
+	Result.HitsAgreed += bServerAgreed ? 1 : 0;
+	Result.ConfirmLatencies.Add((FPlatformTime::Seconds() - ClaimTime) * 1000.f);
+}
+
+void UCyclopeNetBenchmarkSubsystem::OnProfileChanged(int32 ProfileIdx)
+{
+	// Answers and profile changes come through the same reliable channel, so every answer
+	// the server sent during the previous profile has arrived already
+	DropPendingClaims();
+
+	if (Profiles.IsValidIndex(ProfileIdx))
+	{
+		CurrentProfile = ProfileIdx;
+	}
+}
+
+void UCyclopeNetBenchmarkSubsystem::DropPendingClaims()
+{
+	if (Results.IsValidIndex(CurrentProfile))
+	{
+		Results[CurrentProfile].HitsLost += PendingClaims.Num();
+	}
+	PendingClaims.Reset();
+}
+
+void UCyclopeNetBenchmarkSubsystem::OnServerHitClaimed(ACyclopePlayerController* ShooterPC, uint16 ClaimId,
+	const FHitResult& Impact, float TargetTimestamp)
+{
+	if (!ShooterPC || !Results.IsValidIndex(CurrentProfile))
+	{
+		return;
+	}
+
+	// Victim already destroyed, or not a character: nothing to judge against
+	auto Victim = Cast<ACyclopeFightCharacter>(Impact.GetActor());
+	if (!Victim)
+	{
+		ShooterPC->Client_BenchHitConfirmed(ClaimId, false);
+		return;
+	}
+
+	// Would the server have hit the victim where the shooter saw it, or where it is right now
+	FVector VictimLocation = Victim->GetActorLocation();
+	const auto VictimMovement = Cast<UCyclopeCharacterMovementComponent>(Victim->GetCharacterMovement());
+	if (VictimMovement && VictimMovement->GetHistoricalLocation(TargetTimestamp, VictimLocation))
+	{
+		Results[CurrentProfile].HitsRewound++;
+	}
+
+	float Radius, HalfHeight;
+	Victim->GetCapsuleComponent()->GetScaledCapsuleSize(Radius, HalfHeight);
+	const FVector Local = Impact.ImpactPoint - VictimLocation;
+	const bool bAgreed = Local.Size2D() <= Radius + AgreeTolerance &&
+		FMath::Abs(Local.Z) <= HalfHeight + AgreeTolerance;
+
+	ShooterPC->Client_BenchHitConfirmed(ClaimId, bAgreed);
+}
+
+void UCyclopeNetBenchmarkSubsystem::OnServerHitReceived()
+{
+	if (Results.IsValidIndex(CurrentProfile))
+	{
+		Results[CurrentProfile].HitsReceived++;
+	}
+}
+
+void UCyclopeNetBenchmarkSubsystem::OnServerMissReceived()
+{
+	if (Results.IsValidIndex(CurrentProfile))
+	{
+		Results[CurrentProfile].MissesReceived++;
+	}
+}
+
+void UCyclopeNetBenchmarkSubsystem::ApplyProfile(int32 ProfileIdx)
+{
+	LastPacketStats = FCyclopePacketStats::Get();
+
+	// Clients charge their shots and claims to the profile they are told about
+	for (auto It = GetWorld()->GetPlayerControllerIterator(); It; ++It)
+	{
+		const auto PC = Cast<ACyclopePlayerController>(It->Get());
+		if (PC && !PC->IsLocalController() && !PC->IsReplayRecorder())
+		{
+			PC->Client_BenchProfileChanged(static_cast<uint8>(ProfileIdx));
+		}
+	}
+
+#if DO_ENABLE_NET_TEST
+	auto NetDriver = GetWorld()->GetNetDriver();
+	if (!NetDriver || !Profiles.IsValidIndex(ProfileIdx))
+	{
+		return;
+	}
+
+	const auto& Profile = Profiles[ProfileIdx];
+
+	FPacketSimulationSettings Settings;
+	Settings.PktLag = Profile.PktLag;
+	Settings.PktLagVariance = Profile.PktLagVariance;
+	Settings.PktLoss = Profile.PktLoss;
+	Settings.PktIncomingLagMin = Profile.PktLag;
+	Settings.PktIncomingLagMax = Profile.PktLag + Profile.PktLagVariance;
+	Settings.PktIncomingLoss = Profile.PktLoss;
+	NetDriver->SetPacketSimulationSettings(Settings);
+
+	UE_LOG(LogCyclope, Log, TEXT("NetBench: profile %s (lag %dms, jitter %dms, loss %d%%)"), *Profile.Name,
+	       Profile.PktLag, Profile.PktLagVariance, Profile.PktLoss);
+#else
+	UE_LOG(LogCyclope, Warning, TEXT("NetBench: packet simulation is compiled out of this build"));
+#endif
+}
+
+void UCyclopeNetBenchmarkSubsystem::CollectPacketStats(int32 ProfileIdx)
+{
+	const auto& Stats = FCyclopePacketStats::Get();
+	auto& Result = Results[ProfileIdx];
+
+	Result.Packets += Stats.Packets - LastPacketStats.Packets;
+	Result.RawBits += Stats.RawBits - LastPacketStats.RawBits;
+	Result.WireBits += Stats.WireBits - LastPacketStats.WireBits;
+	Result.CodecSeconds += Stats.CodecSeconds - LastPacketStats.CodecSeconds;
+
+	LastPacketStats = Stats;
+}
+
+void UCyclopeNetBenchmarkSubsystem::WriteReport(bool bServer) const
+{
+	FString Csv = bServer
+		              ? TEXT("Profile,HitsReceived,HitsRewound,MissesReceived,BytesInPerPlayerSec,BytesOutPerPlayerSec,"
+			              "CompressionRatio,CodecUsPerPacket,GameThreadMs,ReplayBytesPerSec\n")
+		              : TEXT("Profile,ShotsFired,HitsClaimed,HitsConfirmed,HitsLost,AgreedPct,P50Ms,P90Ms,P99Ms\n");
+
+	for (int32 Idx = 0; Idx < Results.Num(); ++Idx)
+	{
+		const auto& Result = Results[Idx];
+		const auto& Name = Profiles[Idx].Name;
+
+		if (bServer)
+		{
+			const double PlayerSeconds = FMath::Max(Result.PlayerSeconds, 1.0);
+			const double InRate = Result.BytesIn / PlayerSeconds;
+			const double OutRate = Result.BytesOut / PlayerSeconds;
+			const double Ratio = Result.RawBits > 0 ? static_cast<double>(Result.WireBits) / Result.RawBits : 1.0;
+			const double CodecUs = Result.Packets > 0 ? Result.CodecSeconds * 1000000.0 / Result.Packets : 0.0;
+			const double GameThreadMs = Result.Frames > 0 ? Result.GameThreadMs / Result.Frames : 0.0;
+			const double ReplayRate = Result.ReplayBytes / FMath::Max(Result.Seconds, 1.0);
+
+			UE_LOG(LogCyclope, Display,
+			       TEXT("NetBench [%s] hits %d (%d rewound) misses %d, up %.0f B/s, down %.0f B/s per player, compression %.3f at %.2fus/packet, game thread %.2fms, replay %.0f B/s"),
+			       *Name, Result.HitsReceived, Result.HitsRewound, Result.MissesReceived, InRate, OutRate, Ratio, CodecUs,
+			       GameThreadMs, ReplayRate);
+			Csv += FString::Printf(TEXT("%s,%d,%d,%d,%.0f,%.0f,%.3f,%.2f,%.2f,%.0f\n"), *Name, Result.HitsReceived,
+			                       Result.HitsRewound, Result.MissesReceived, InRate, OutRate, Ratio, CodecUs, GameThreadMs,
+			                       ReplayRate);
+		}
+		else
+		{
+			auto Latencies = Result.ConfirmLatencies;
+			Latencies.Sort();
+			auto Percentile = [&Latencies](float Pct)
+			{
+				return Latencies.Num() > 0
+					       ? Latencies[FMath::Min(Latencies.Num() - 1, FMath::FloorToInt(Latencies.Num() * Pct))]
+					       : 0.f;
+			};
+			const float AgreedPct = Result.HitsConfirmed > 0
+				                        ? 100.f * Result.HitsAgreed / Result.HitsConfirmed
+				                        : 0.f;
+
+			UE_LOG(LogCyclope, Display,
+			       TEXT("NetBench [%s] shots %d claimed %d confirmed %d lost %d agreed %.1f%%, latency p50 %.0fms p90 %.0fms p99 %.0fms"),
+			       *Name, Result.ShotsFired, Result.HitsClaimed, Result.HitsConfirmed, Result.HitsLost, AgreedPct,
+			       Percentile(0.5f), Percentile(0.9f), Percentile(0.99f));
+			Csv += FString::Printf(TEXT("%s,%d,%d,%d,%d,%.1f,%.0f,%.0f,%.0f\n"), *Name, Result.ShotsFired,
+			                       Result.HitsClaimed, Result.HitsConfirmed, Result.HitsLost, AgreedPct,
+			                       Percentile(0.5f), Percentile(0.9f), Percentile(0.99f));
+		}
+	}
+
+	const FString FileName = FString::Printf(TEXT("NetBench_%s_%d.csv"), bServer ? TEXT("Server") : TEXT("Client"),
+	                                         FPlatformProcess::GetCurrentProcessId());
+	FFileHelper::SaveStringToFile(Csv, *FPaths::Combine(FPaths::ProjectSavedDir(), TEXT("Benchmarks"), FileName));
+}
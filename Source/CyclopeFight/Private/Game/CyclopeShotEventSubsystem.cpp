@@ -0,0 +1,128 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "Game/CyclopeShotEventSubsystem.h"
+
+#include "CyclopeFight.h"
+#include "Memory/CyclopeAllocTracker.h"
+#include "Player/CyclopeFightCharacter.h"
+#include "Player/CyclopePlayerController.h"
+
+DECLARE_CYCLE_STAT(TEXT("Shot interest management"), STAT_CyclopeShotInterest, STATGROUP_Cyclope);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Shot events sent"), STAT_CyclopeShotEventsSent, STATGROUP_Cyclope);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Shot events filtered"), STAT_CyclopeShotEventsFiltered, STATGROUP_Cyclope);
+
+UCyclopeShotEventSubsystem::UCyclopeShotEventSubsystem()
+{
+	ShotRelevanceRadius = 5000.f;
+}
+
+void UCyclopeShotEventSubsystem::Deinitialize()
+{
+	PendingShots.Empty();
+
+	Super::Deinitialize();
+}
+
+ETickableTickType UCyclopeShotEventSubsystem::GetTickableTickType() const
+{
+	return HasAnyFlags(RF_ClassDefaultObject) ? ETickableTickType::Never : ETickableTickType::Conditional;
+}
+
+bool UCyclopeShotEventSubsystem::IsTickable() const
+{
+	return PendingShots.Num() > 0;
+}
+
+TStatId UCyclopeShotEventSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UCyclopeShotEventSubsystem, STATGROUP_Tickables);
+}
+
+UWorld* UCyclopeShotEventSubsystem::GetTickableGameObjectWorld() const
+{
+	return GetWorld();
+}
+
+void UCyclopeShotEventSubsystem::QueueShot(ACyclopeFightCharacter* Shooter, const FVector& Origin,
+	const FVector& ShootDir, float Range)
+{
+	FLaserShotEvent Shot;
+	Shot.Shooter = Shooter;
+	Shot.Origin = Origin;
+	Shot.ShootDir = ShootDir;
+	Shot.End = Origin + ShootDir * Range;
+
+	PendingShots.Add(Shot);
+}
+
+void UCyclopeShotEventSubsystem::Tick(float DeltaTime)
+{
+	SCOPE_CYCLE_COUNTER(STAT_CyclopeShotInterest);
+	CYCLOPE_SCOPE_ALLOCS();
+
+	TArray<FLaserShotEvent> ShotsForViewer;
+	for (auto It = GetWorld()->GetPlayerControllerIterator(); It; ++It)
+	{
+		const auto PC = Cast<ACyclopePlayerController>(It->Get());
+		if (!PC || PC->IsLocalController())
+		{
+			// The local player of a listen server already played its FX in ProcessHit_Confirmed
+			continue;
+		}
+
+		ShotsForViewer.Reset();
+		if (PC->IsReplayRecorder())
+		{
+			// Replay spectators can look anywhere, so the recording gets every shot
+			for (const auto& Shot : PendingShots)
+			{
+				if (Shot.Shooter)
+				{
+					ShotsForViewer.Add(Shot);
+				}
+			}
+		}
+		else
+		{
+			GatherShotsFor(PC, ShotsForViewer);
+		}
+
+		if (ShotsForViewer.Num() > 0)
+		{
+			PC->Client_ReceiveLaserShots(ShotsForViewer);
+		}
+	}
+
+	PendingShots.Reset();
+}
+
+void UCyclopeShotEventSubsystem::GatherShotsFor(const ACyclopePlayerController* PC,
+	TArray<FLaserShotEvent>& OutShots) const
+{
+	FVector ViewLocation;
+	FRotator ViewRotation;
+	PC->GetPlayerViewPoint(ViewLocation, ViewRotation);
+
+	const float RadiusSq = FMath::Square(ShotRelevanceRadius);
+
+	for (const auto& Shot : PendingShots)
+	{
+		if (!Shot.Shooter || Shot.Shooter->GetController() == PC)
+		{
+			continue;
+		}
+
+		// Segment vs sphere around the viewer
+		const FVector Closest = FMath::ClosestPointOnSegment(ViewLocation, Shot.Origin, Shot.End);
+		if (FVector::DistSquared(Closest, ViewLocation) <= RadiusSq)
+		{
+			OutShots.Add(Shot);
+			INC_DWORD_STAT(STAT_CyclopeShotEventsSent);
+		}
+		else
+		{
+			INC_DWORD_STAT(STAT_CyclopeShotEventsFiltered);
+		}
+	}
+}
@@ -0,0 +1,164 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "Memory/CyclopeAllocTracker.h"
+
+#include "CyclopeFight.h"
+#include "HAL/MemoryBase.h"
+#include "Templates/Atomic.h"
+
+namespace
+{
+	thread_local int32 GScopeDepth = 0;
+
+	TAtomic<uint64> GAllocs(0);
+	TAtomic<uint64> GModuleAllocs(0);
+	TAtomic<uint64> GModuleBytes(0);
+
+	/** Forwards everything to the allocator it wraps. Counting must never allocate **/
+	class FCyclopeCountingMalloc final : public FMalloc
+	{
+	public:
+		explicit FCyclopeCountingMalloc(FMalloc* InUsedMalloc)
+			: UsedMalloc(InUsedMalloc)
+		{
+		}
+
+		virtual void* Malloc(SIZE_T Size, uint32 Alignment) override
+		{
+			Count(Size);
+			return UsedMalloc->Malloc(Size, Alignment);
+		}
+
+		virtual void* Realloc(void* Ptr, SIZE_T NewSize, uint32 Alignment) override
+		{
+			// Growing a container usually moves it to a new block, count it as an allocation
+			if (NewSize > 0)
+			{
+				Count(NewSize);
+			}
+			return UsedMalloc->Realloc(Ptr, NewSize, Alignment);
+		}
+
+		virtual void Free(void* Ptr) override
+		{
+			UsedMalloc->Free(Ptr);
+		}
+
+		virtual SIZE_T QuantizeSize(SIZE_T Size, uint32 Alignment) override
+		{
+			return UsedMalloc->QuantizeSize(Size, Alignment);
+		}
+
+		virtual bool GetAllocationSize(void* Original, SIZE_T& SizeOut) override
+		{
+			return UsedMalloc->GetAllocationSize(Original, SizeOut);
+		}
+
+		virtual void Trim(bool bTrimThreadCaches) override
+		{
+			UsedMalloc->Trim(bTrimThreadCaches);
+		}
+
+		virtual void SetupTLSCachesOnCurrentThread() override
+		{
+			UsedMalloc->SetupTLSCachesOnCurrentThread();
+		}
+
+		virtual void ClearAndDisableTLSCachesOnCurrentThread() override
+		{
+			UsedMalloc->ClearAndDisableTLSCachesOnCurrentThread();
+		}
+
+		virtual void InitializeStatsMetadata() override
+		{
+			UsedMalloc->InitializeStatsMetadata();
+		}
+
+		virtual void UpdateStats() override
+		{
+			UsedMalloc->UpdateStats();
+		}
+
+		virtual void GetAllocatorStats(FGenericMemoryStats& OutStats) override
+		{
+			UsedMalloc->GetAllocatorStats(OutStats);
+		}
+
+		virtual void DumpAllocatorStats(FOutputDevice& Ar) override
+		{
+			UsedMalloc->DumpAllocatorStats(Ar);
+		}
+
+		virtual bool IsInternallyThreadSafe() const override
+		{
+			return UsedMalloc->IsInternallyThreadSafe();
+		}
+
+		virtual bool ValidateHeap() override
+		{
+			return UsedMalloc->ValidateHeap();
+		}
+
+		virtual const TCHAR* GetDescriptiveName() override
+		{
+			return UsedMalloc->GetDescriptiveName();
+		}
+
+	private:
+		static void Count(SIZE_T Size)
+		{
+			++GAllocs;
+			if (GScopeDepth > 0)
+			{
+				++GModuleAllocs;
+				GModuleBytes += Size;
+			}
+		}
+
+		FMalloc* UsedMalloc;
+	};
+
+	FCyclopeCountingMalloc* GCountingMalloc = nullptr;
+}
+
+void FCyclopeAllocTracker::Install()
+{
+	check(IsInGameThread());
+
+	if (GCountingMalloc || !GMalloc)
+	{
+		return;
+	}
+
+	// Blocks allocated before this point are freed through the wrapper just fine. It is never
+	// removed, other threads may be inside it at any time
+	GCountingMalloc = new FCyclopeCountingMalloc(GMalloc);
+	GMalloc = GCountingMalloc;
+
+	UE_LOG(LogCyclope, Log, TEXT("Allocation tracking installed over %s"), GMalloc->GetDescriptiveName());
+}
+
+bool FCyclopeAllocTracker::IsInstalled()
+{
+	return GCountingMalloc != nullptr;
+}
+
+FCyclopeAllocCounts FCyclopeAllocTracker::GetCounts()
+{
+	FCyclopeAllocCounts Counts;
+	Counts.Allocs = GAllocs.Load(EMemoryOrder::Relaxed);
+	Counts.ModuleAllocs = GModuleAllocs.Load(EMemoryOrder::Relaxed);
+	Counts.ModuleBytes = GModuleBytes.Load(EMemoryOrder::Relaxed);
+	return Counts;
+}
+
+void FCyclopeAllocTracker::EnterScope()
+{
+	++GScopeDepth;
+}
+
+void FCyclopeAllocTracker::ExitScope()
+{
+	--GScopeDepth;
+}
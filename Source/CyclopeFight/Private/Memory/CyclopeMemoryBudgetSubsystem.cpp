@@ -0,0 +1,401 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "Memory/CyclopeMemoryBudgetSubsystem.h"
+
+#include "CyclopeFight.h"
+#include "Engine/World.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+#include "ProfilingDebugging/CsvProfiler.h"
+#include "UObject/Package.h"
+#include "UObject/UObjectGlobals.h"
+
+DECLARE_DWORD_COUNTER_STAT(TEXT("Allocations"), STAT_CyclopeAllocs, STATGROUP_Cyclope);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Allocations by gameplay code"), STAT_CyclopeModuleAllocs, STATGROUP_Cyclope);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Bytes allocated by gameplay code"), STAT_CyclopeModuleBytes, STATGROUP_Cyclope);
+DECLARE_DWORD_COUNTER_STAT(TEXT("UObjects created"), STAT_CyclopeObjectsCreated, STATGROUP_Cyclope);
+DECLARE_DWORD_COUNTER_STAT(TEXT("UObjects destroyed"), STAT_CyclopeObjectsDestroyed, STATGROUP_Cyclope);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("GC count"), STAT_CyclopeGCCount, STATGROUP_Cyclope);
+DECLARE_FLOAT_ACCUMULATOR_STAT(TEXT("Last GC pause (ms)"), STAT_CyclopeLastGCMs, STATGROUP_Cyclope);
+
+CSV_DEFINE_CATEGORY(CyclopeMemory, true);
+
+namespace
+{
+	/** World subsystem measuring the allocations and GC pauses of the process **/
+	const UCyclopeMemoryBudgetSubsystem* GProcessMeasuringSubsystem = nullptr;
+}
+
+FCyclopeObjectCounter::FCyclopeObjectCounter()
+{
+	FrameCreated = 0;
+	FrameDestroyed = 0;
+	bListening = false;
+	PIEInstanceID = INDEX_NONE;
+}
+
+FCyclopeObjectCounter::~FCyclopeObjectCounter()
+{
+	StopListening();
+}
+
+void FCyclopeObjectCounter::StartListening(const UWorld* World)
+{
+#if WITH_EDITOR
+	PIEInstanceID = World ? World->GetOutermost()->PIEInstanceID : INDEX_NONE;
+#endif
+
+	if (!bListening)
+	{
+		bListening = true;
+		GUObjectArray.AddUObjectCreateListener(this);
+		GUObjectArray.AddUObjectDeleteListener(this);
+	}
+}
+
+void FCyclopeObjectCounter::StopListening()
+{
+	if (bListening)
+	{
+		bListening = false;
+		GUObjectArray.RemoveUObjectCreateListener(this);
+		GUObjectArray.RemoveUObjectDeleteListener(this);
+	}
+}
+
+void FCyclopeObjectCounter::Reset()
+{
+	FScopeLock ScopeLock(&Lock);
+	ClassCounts.Reset();
+	LiveClasses.Reset();
+	FrameCreated = 0;
+	FrameDestroyed = 0;
+}
+
+bool FCyclopeObjectCounter::IsInWorld(const UObjectBase* Object) const
+{
+#if WITH_EDITOR
+	// Only the editor runs several game worlds in one process. Called while the object is being
+	// constructed, so only walk the outers: PIE loads each instance's levels into its own packages
+	const UObjectBase* Outermost = Object;
+	while (Outermost->GetOuter())
+	{
+		Outermost = Outermost->GetOuter();
+	}
+	const auto Package = Outermost->GetClass() == UPackage::StaticClass()
+		                     ? static_cast<const UPackage*>(Outermost)
+		                     : nullptr;
+	return (Package ? Package->PIEInstanceID : INDEX_NONE) == PIEInstanceID;
+#else
+	return true;
+#endif
+}
+
+void FCyclopeObjectCounter::NotifyUObjectCreated(const UObjectBase* Object, int32 Index)
+{
+	if (!IsInWorld(Object))
+	{
+		return;
+	}
+
+	const auto Class = Object->GetClass();
+	const FName ClassName = Class ? Class->GetFName() : NAME_None;
+
+	FScopeLock ScopeLock(&Lock);
+	ClassCounts.FindOrAdd(ClassName).Created++;
+	LiveClasses.Add(Index, ClassName);
+	FrameCreated++;
+}
+
+void FCyclopeObjectCounter::NotifyUObjectDeleted(const UObjectBase* Object, int32 Index)
+{
+	FScopeLock ScopeLock(&Lock);
+	FName ClassName;
+	if (LiveClasses.RemoveAndCopyValue(Index, ClassName))
+	{
+		ClassCounts.FindOrAdd(ClassName).Destroyed++;
+		FrameDestroyed++;
+	}
+}
+
+void FCyclopeObjectCounter::OnUObjectArrayShutdown()
+{
+	StopListening();
+}
+
+void FCyclopeObjectCounter::ConsumeFrameCounts(int32& OutCreated, int32& OutDestroyed)
+{
+	FScopeLock ScopeLock(&Lock);
+	OutCreated = FrameCreated;
+	OutDestroyed = FrameDestroyed;
+	FrameCreated = 0;
+	FrameDestroyed = 0;
+}
+
+TMap<FName, FCyclopeClassObjectCounts> FCyclopeObjectCounter::GetClassCounts() const
+{
+	FScopeLock ScopeLock(&Lock);
+	return ClassCounts;
+}
+
+UCyclopeMemoryBudgetSubsystem::UCyclopeMemoryBudgetSubsystem()
+{
+	bTrackAllocations = false;
+	MaxAllocsPerFrame = 20000;
+	MaxModuleAllocsPerFrame = 200;
+	MaxObjectsCreatedPerFrame = 50;
+	MaxGCPauseMs = 10.f;
+	WarningInterval = 5.f;
+
+	bMatchStarted = false;
+	bMeasuresProcess = false;
+
+	NumFrames = 0;
+	TotalAllocs = 0;
+	PeakAllocs = 0;
+	TotalModuleAllocs = 0;
+	PeakModuleAllocs = 0;
+	TotalModuleBytes = 0;
+	PeakObjectsCreated = 0;
+
+	GCStartTime = 0.0;
+	NumGCs = 0;
+	TotalGCMs = 0.0;
+	PeakGCMs = 0.0;
+
+	for (int32 Budget = 0; Budget < Budget_Count; Budget++)
+	{
+		Overruns[Budget] = 0;
+		LastWarningTime[Budget] = -DBL_MAX;
+	}
+}
+
+bool UCyclopeMemoryBudgetSubsystem::ShouldCreateSubsystem(UObject* Outer) const
+{
+	// A match is a game world, editor and preview worlds are not measured
+	const auto World = Cast<UWorld>(Outer);
+	return World && World->IsGameWorld() && Super::ShouldCreateSubsystem(Outer);
+}
+
+void UCyclopeMemoryBudgetSubsystem::Initialize(FSubsystemCollectionBase& Collection)
+{
+	Super::Initialize(Collection);
+
+	ObjectCounter.StartListening(GetWorld());
+
+	bMeasuresProcess = GProcessMeasuringSubsystem == nullptr;
+	if (bMeasuresProcess)
+	{
+		GProcessMeasuringSubsystem = this;
+
+		PreGCHandle = FCoreUObjectDelegates::GetPreGarbageCollectDelegate().AddUObject(this,
+			&UCyclopeMemoryBudgetSubsystem::OnPreGarbageCollect);
+		PostGCHandle = FCoreUObjectDelegates::GetPostGarbageCollect().AddUObject(this,
+			&UCyclopeMemoryBudgetSubsystem::OnPostGarbageCollect);
+	}
+
+	ResetFrameCounters();
+}
+
+void UCyclopeMemoryBudgetSubsystem::OnWorldBeginPlay(UWorld& InWorld)
+{
+	Super::OnWorldBeginPlay(InWorld);
+
+	ResetFrameCounters();
+}
+
+void UCyclopeMemoryBudgetSubsystem::ResetFrameCounters()
+{
+	LastAllocCounts = bMeasuresProcess ? FCyclopeAllocTracker::GetCounts() : FCyclopeAllocCounts();
+
+	int32 ObjectsCreated, ObjectsDestroyed;
+	ObjectCounter.ConsumeFrameCounts(ObjectsCreated, ObjectsDestroyed);
+}
+
+void UCyclopeMemoryBudgetSubsystem::Deinitialize()
+{
+	ObjectCounter.StopListening();
+
+	if (bMeasuresProcess)
+	{
+		GProcessMeasuringSubsystem = nullptr;
+
+		FCoreUObjectDelegates::GetPreGarbageCollectDelegate().Remove(PreGCHandle);
+		FCoreUObjectDelegates::GetPostGarbageCollect().Remove(PostGCHandle);
+	}
+
+	if (!HasAnyFlags(RF_ClassDefaultObject) && NumFrames > 0)
+	{
+		LogSummary();
+		WriteReport();
+	}
+
+	Super::Deinitialize();
+}
+
+ETickableTickType UCyclopeMemoryBudgetSubsystem::GetTickableTickType() const
+{
+	return HasAnyFlags(RF_ClassDefaultObject) ? ETickableTickType::Never : ETickableTickType::Always;
+}
+
+TStatId UCyclopeMemoryBudgetSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UCyclopeMemoryBudgetSubsystem, STATGROUP_Tickables);
+}
+
+UWorld* UCyclopeMemoryBudgetSubsystem::GetTickableGameObjectWorld() const
+{
+	return GetWorld();
+}
+
+void UCyclopeMemoryBudgetSubsystem::Tick(float DeltaTime)
+{
+	// Subsystems begin play before the actors do, so the first frame of play still carries
+	// their BeginPlay. Drop it along with the map load
+	if (!bMatchStarted)
+	{
+		ResetFrameCounters();
+		bMatchStarted = GetWorld() && GetWorld()->HasBegunPlay();
+		if (bMatchStarted)
+		{
+			// The class report covers the match only, not the objects of the map and its actors
+			ObjectCounter.Reset();
+		}
+		return;
+	}
+
+	// Everything between two ticks, the tickable runs once per frame
+	const FCyclopeAllocCounts Counts = bMeasuresProcess ? FCyclopeAllocTracker::GetCounts() : FCyclopeAllocCounts();
+	const uint64 Allocs = Counts.Allocs - LastAllocCounts.Allocs;
+	const uint64 ModuleAllocs = Counts.ModuleAllocs - LastAllocCounts.ModuleAllocs;
+	const uint64 ModuleBytes = Counts.ModuleBytes - LastAllocCounts.ModuleBytes;
+	LastAllocCounts = Counts;
+
+	int32 ObjectsCreated, ObjectsDestroyed;
+	ObjectCounter.ConsumeFrameCounts(ObjectsCreated, ObjectsDestroyed);
+
+	INC_DWORD_STAT_BY(STAT_CyclopeAllocs, Allocs);
+	INC_DWORD_STAT_BY(STAT_CyclopeModuleAllocs, ModuleAllocs);
+	INC_DWORD_STAT_BY(STAT_CyclopeModuleBytes, ModuleBytes);
+	INC_DWORD_STAT_BY(STAT_CyclopeObjectsCreated, ObjectsCreated);
+	INC_DWORD_STAT_BY(STAT_CyclopeObjectsDestroyed, ObjectsDestroyed);
+
+	CSV_CUSTOM_STAT(CyclopeMemory, Allocs, static_cast<int32>(Allocs), ECsvCustomStatOp::Set);
+	CSV_CUSTOM_STAT(CyclopeMemory, ModuleAllocs, static_cast<int32>(ModuleAllocs), ECsvCustomStatOp::Set);
+	CSV_CUSTOM_STAT(CyclopeMemory, ModuleKiB, ModuleBytes / 1024.f, ECsvCustomStatOp::Set);
+	CSV_CUSTOM_STAT(CyclopeMemory, ObjectsCreated, ObjectsCreated, ECsvCustomStatOp::Set);
+	CSV_CUSTOM_STAT(CyclopeMemory, ObjectsDestroyed, ObjectsDestroyed, ECsvCustomStatOp::Set);
+
+	NumFrames++;
+	TotalAllocs += Allocs;
+	PeakAllocs = FMath::Max(PeakAllocs, Allocs);
+	TotalModuleAllocs += ModuleAllocs;
+	PeakModuleAllocs = FMath::Max(PeakModuleAllocs, ModuleAllocs);
+	TotalModuleBytes += ModuleBytes;
+	PeakObjectsCreated = FMath::Max(PeakObjectsCreated, ObjectsCreated);
+
+	if (bMeasuresProcess && FCyclopeAllocTracker::IsInstalled())
+	{
+		CheckBudget(Budget_Allocs, Allocs, MaxAllocsPerFrame, TEXT("allocations in a frame"));
+		CheckBudget(Budget_ModuleAllocs, ModuleAllocs, MaxModuleAllocsPerFrame,
+		            TEXT("allocations by gameplay code in a frame"));
+	}
+	CheckBudget(Budget_ObjectsCreated, ObjectsCreated, MaxObjectsCreatedPerFrame, TEXT("UObjects created in a frame"));
+}
+
+void UCyclopeMemoryBudgetSubsystem::OnPreGarbageCollect()
+{
+	GCStartTime = FPlatformTime::Seconds();
+}
+
+void UCyclopeMemoryBudgetSubsystem::OnPostGarbageCollect()
+{
+	// The collection after loading the map is not part of the match
+	if (!bMatchStarted)
+	{
+		return;
+	}
+
+	// Reachability analysis and, unless incremental, the purge: the time the game thread stood still
+	const double PauseMs = (FPlatformTime::Seconds() - GCStartTime) * 1000.0;
+
+	NumGCs++;
+	TotalGCMs += PauseMs;
+	PeakGCMs = FMath::Max(PeakGCMs, PauseMs);
+
+	SET_DWORD_STAT(STAT_CyclopeGCCount, NumGCs);
+	SET_FLOAT_STAT(STAT_CyclopeLastGCMs, PauseMs);
+	CSV_CUSTOM_STAT(CyclopeMemory, GCPauseMs, static_cast<float>(PauseMs), ECsvCustomStatOp::Set);
+
+	CheckBudget(Budget_GCPause, PauseMs, MaxGCPauseMs, TEXT("ms of garbage collection"));
+}
+
+void UCyclopeMemoryBudgetSubsystem::CheckBudget(EBudget Budget, double Value, double Limit, const TCHAR* What)
+{
+	if (Limit <= 0.0 || Value <= Limit)
+	{
+		return;
+	}
+
+	Overruns[Budget]++;
+
+	const double Now = FPlatformTime::Seconds();
+	if (Now - LastWarningTime[Budget] >= WarningInterval)
+	{
+		LastWarningTime[Budget] = Now;
+		UE_LOG(LogCyclope, Warning, TEXT("Memory budget: %.1f %s, budget is %.1f (%d overruns this match)"),
+		       Value, What, Limit, Overruns[Budget]);
+	}
+}
+
+void UCyclopeMemoryBudgetSubsystem::LogSummary() const
+{
+	if (bMeasuresProcess && FCyclopeAllocTracker::IsInstalled())
+	{
+		UE_LOG(LogCyclope, Display,
+		       TEXT("Memory: %lld frames, %.0f allocations per frame (peak %llu), gameplay code %.1f per frame (peak %llu, %.1f KiB total)"),
+		       NumFrames, static_cast<double>(TotalAllocs) / NumFrames, PeakAllocs,
+		       static_cast<double>(TotalModuleAllocs) / NumFrames, PeakModuleAllocs, TotalModuleBytes / 1024.0);
+	}
+
+	if (bMeasuresProcess)
+	{
+		UE_LOG(LogCyclope, Display, TEXT("Memory: %d GCs, %.1fms average pause, %.1fms worst"),
+		       NumGCs, NumGCs > 0 ? TotalGCMs / NumGCs : 0.0, PeakGCMs);
+	}
+
+	UE_LOG(LogCyclope, Display, TEXT("Memory: peak of %d UObjects created in a frame"), PeakObjectsCreated);
+
+	UE_LOG(LogCyclope, Display, TEXT("Memory: budget overruns: %d allocations, %d gameplay allocations, %d UObjects, %d GC pauses"),
+	       Overruns[Budget_Allocs], Overruns[Budget_ModuleAllocs], Overruns[Budget_ObjectsCreated],
+	       Overruns[Budget_GCPause]);
+}
+
+void UCyclopeMemoryBudgetSubsystem::WriteReport() const
+{
+	auto ClassCounts = ObjectCounter.GetClassCounts();
+	ClassCounts.ValueSort([](const FCyclopeClassObjectCounts& A, const FCyclopeClassObjectCounts& B)
+	{
+		return A.Created > B.Created;
+	});
+
+	TArray<FString> Rows;
+	for (const auto& Pair : ClassCounts)
+	{
+		Rows.Add(FString::Printf(TEXT("%s,%d,%d"), *Pair.Key.ToString(), Pair.Value.Created, Pair.Value.Destroyed));
+	}
+
+	const FString Csv = TEXT("Class,Created,Destroyed\n") + FString::Join(Rows, TEXT("\n")) + TEXT("\n");
+
+	// PIE runs the server and clients in one process, one report per world
+	FString FileName = FString::Printf(TEXT("Memory_%d"), FPlatformProcess::GetCurrentProcessId());
+#if WITH_EDITOR
+	if (GetWorld() && GetWorld()->GetOutermost()->PIEInstanceID != INDEX_NONE)
+	{
+		FileName += FString::Printf(TEXT("_%d"), GetWorld()->GetOutermost()->PIEInstanceID);
+	}
+#endif
+	FileName += TEXT(".csv");
+	FFileHelper::SaveStringToFile(Csv, *FPaths::Combine(FPaths::ProjectSavedDir(), TEXT("Benchmarks"), FileName));
+}
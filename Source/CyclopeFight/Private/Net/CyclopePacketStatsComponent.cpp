@@ -0,0 +1,91 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "Net/CyclopePacketStatsComponent.h"
+
+#include "CyclopeFight.h"
+
+DECLARE_DWORD_COUNTER_STAT(TEXT("Packet raw bits"), STAT_CyclopePacketRawBits, STATGROUP_Cyclope);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Packet wire bits"), STAT_CyclopePacketWireBits, STATGROUP_Cyclope);
+
+namespace CyclopePacketStats
+{
+	/** Packets go through the handler chain one at a time on the game thread **/
+	double CodecStartTime = 0.0;
+	uint64 PendingRawBits = 0;
+	uint64 PendingWireBits = 0;
+
+	void Record(uint64 RawBits, uint64 WireBits)
+	{
+		auto& Stats = FCyclopePacketStats::Get();
+		Stats.Packets++;
+		Stats.RawBits += RawBits;
+		Stats.WireBits += WireBits;
+		Stats.CodecSeconds += FPlatformTime::Seconds() - CodecStartTime;
+
+		INC_DWORD_STAT_BY(STAT_CyclopePacketRawBits, RawBits);
+		INC_DWORD_STAT_BY(STAT_CyclopePacketWireBits, WireBits);
+	}
+}
+
+FCyclopePacketStats& FCyclopePacketStats::Get()
+{
+	static FCyclopePacketStats Stats;
+	return Stats;
+}
+
+FCyclopePacketStatsComponent::FCyclopePacketStatsComponent(ECyclopePacketStatsStage InStage)
+	: HandlerComponent(FName(TEXT("CyclopePacketStats")))
+	, Stage(InStage)
+{
+}
+
+bool FCyclopePacketStatsComponent::IsValid() const
+{
+	return true;
+}
+
+void FCyclopePacketStatsComponent::Initialize()
+{
+	SetActive(true);
+	SetState(Handler::Component::State::Initialized);
+	Initialized();
+}
+
+bool FCyclopePacketStatsComponent::CanReadUnaligned() const
+{
+	return true;
+}
+
+int32 FCyclopePacketStatsComponent::GetReservedPacketBits() const
+{
+	return 0;
+}
+
+void FCyclopePacketStatsComponent::Outgoing(FBitWriter& Packet, FOutPacketTraits& Traits)
+{
+	// Outgoing packets visit components in list order: Raw, compression, Wire
+	if (Stage == ECyclopePacketStatsStage::Raw)
+	{
+		CyclopePacketStats::PendingRawBits = Packet.GetNumBits();
+		CyclopePacketStats::CodecStartTime = FPlatformTime::Seconds();
+	}
+	else
+	{
+		CyclopePacketStats::Record(CyclopePacketStats::PendingRawBits, Packet.GetNumBits());
+	}
+}
+
+void FCyclopePacketStatsComponent::Incoming(FBitReader& Packet)
+{
+	// Incoming packets visit components in reverse order: Wire, decompression, Raw
+	if (Stage == ECyclopePacketStatsStage::Wire)
+	{
+		CyclopePacketStats::PendingWireBits = Packet.GetBitsLeft();
+		CyclopePacketStats::CodecStartTime = FPlatformTime::Seconds();
+	}
+	else
+	{
+		CyclopePacketStats::Record(Packet.GetBitsLeft(), CyclopePacketStats::PendingWireBits);
+	}
+}
@@ -0,0 +1,505 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "Player/CyclopeCharacterMovementComponent.h"
+
+#include "CyclopeFight.h"
+#include "Engine/Engine.h"
+#include "Components/SkeletalMeshComponent.h"
+#include "GameFramework/Character.h"
+#include "GameFramework/PlayerController.h"
+
+DECLARE_DWORD_COUNTER_STAT(TEXT("Move upstream bits"), STAT_CyclopeMoveUpstreamBits, STATGROUP_Cyclope);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Move downstream bits"), STAT_CyclopeMoveDownstreamBits, STATGROUP_Cyclope);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Proxy frames extrapolated"), STAT_CyclopeProxyExtrapolated, STATGROUP_Cyclope);
+DECLARE_FLOAT_COUNTER_STAT(TEXT("Proxy interpolation delay ms"), STAT_CyclopeProxyDelay, STATGROUP_Cyclope);
+DECLARE_FLOAT_COUNTER_STAT(TEXT("Proxy jitter ms"), STAT_CyclopeProxyJitter, STATGROUP_Cyclope);
+
+namespace CyclopeMovement
+{
+	enum EPackedAccelFormat : uint8
+	{
+		Zero = 0,
+		Planar = 1,
+		Full = 2
+	};
+
+	/** Planar acceleration fits in a 16 bit yaw and an 8 bit fraction of max acceleration **/
+	bool PackPlanarAcceleration(const FVector& Accel, float MaxAccel, uint16& OutYaw, uint8& OutMagnitude)
+	{
+		if (Accel.Z != 0.f || MaxAccel <= 0.f)
+		{
+			return false;
+		}
+
+		OutYaw = FRotator::CompressAxisToShort(FMath::RadiansToDegrees(FMath::Atan2(Accel.Y, Accel.X)));
+		OutMagnitude = static_cast<uint8>(FMath::Clamp(FMath::RoundToInt(Accel.Size2D() / MaxAccel * 255.f), 1, 255));
+		return true;
+	}
+
+	FVector UnpackPlanarAcceleration(uint16 Yaw, uint8 Magnitude, float MaxAccel)
+	{
+		const FRotator Direction(0.f, FRotator::DecompressAxisFromShort(Yaw), 0.f);
+		return Direction.Vector() * (Magnitude / 255.f * MaxAccel);
+	}
+
+	template <typename T>
+	void SerializeOptional(FArchive& Ar, T& Value, const T& DefaultValue)
+	{
+		uint8 bIsDefault = Ar.IsSaving() && Value == DefaultValue;
+		Ar.SerializeBits(&bIsDefault, 1);
+		if (bIsDefault)
+		{
+			Value = DefaultValue;
+		}
+		else
+		{
+			Ar << Value;
+		}
+	}
+}
+
+//////////////////////////////////////////////////////////////////////////
+// FCyclopeCharacterNetworkMoveData
+
+bool FCyclopeCharacterNetworkMoveData::Serialize(UCharacterMovementComponent& CharacterMovement, FArchive& Ar,
+	UPackageMap* PackageMap, ENetworkMoveType MoveType)
+{
+	NetworkMoveType = MoveType;
+	bool bLocalSuccess = true;
+
+	Ar << TimeStamp;
+
+	FVector PackedAcceleration = Acceleration;
+	UCyclopeCharacterMovementComponent::SerializePackedAcceleration(Ar, PackedAcceleration,
+		CharacterMovement.GetMaxAcceleration());
+	Acceleration = PackedAcceleration;
+
+	// Location is only used for error checking, the server tolerance is far above a millimeter
+	FVector_NetQuantize10 PackedLocation = Location;
+	PackedLocation.NetSerialize(Ar, PackageMap, bLocalSuccess);
+	Location = PackedLocation;
+
+	ControlRotation.NetSerialize(Ar, PackageMap, bLocalSuccess);
+
+	CyclopeMovement::SerializeOptional<uint8>(Ar, CompressedMoveFlags, 0);
+
+	if (MoveType == ENetworkMoveType::NewMove)
+	{
+		CyclopeMovement::SerializeOptional<UPrimitiveComponent*>(Ar, MovementBase, nullptr);
+		CyclopeMovement::SerializeOptional<FName>(Ar, MovementBaseBoneName, NAME_None);
+		CyclopeMovement::SerializeOptional<uint8>(Ar, MovementMode, MOVE_Walking);
+	}
+
+	return !Ar.IsError();
+}
+
+FCyclopeCharacterNetworkMoveDataContainer::FCyclopeCharacterNetworkMoveDataContainer()
+{
+	NewMoveData = &CyclopeMoveData[0];
+	PendingMoveData = &CyclopeMoveData[1];
+	OldMoveData = &CyclopeMoveData[2];
+}
+
+//////////////////////////////////////////////////////////////////////////
+// FSavedMove_Cyclope
+
+FSavedMove_Cyclope::FSavedMove_Cyclope()
+{
+	// Engine default is ~5 degrees, combine moves up to ~11 degrees apart
+	AccelDotThresholdCombine = 0.98f;
+	MaxSpeedThresholdCombine = 25.f;
+}
+
+FNetworkPredictionData_Client_Cyclope::FNetworkPredictionData_Client_Cyclope(
+	const UCharacterMovementComponent& ClientMovement)
+	: Super(ClientMovement)
+{
+}
+
+FSavedMovePtr FNetworkPredictionData_Client_Cyclope::AllocateNewMove()
+{
+	return FSavedMovePtr(new FSavedMove_Cyclope());
+}
+
+//////////////////////////////////////////////////////////////////////////
+// UCyclopeCharacterMovementComponent
+
+UCyclopeCharacterMovementComponent::UCyclopeCharacterMovementComponent()
+{
+	SetNetworkMoveDataContainer(CyclopeMoveDataContainer);
+
+	NearProxyDistance = 1500.f;
+	FarProxyDistance = 4000.f;
+	NearSmoothLocationTime = 0.1f;
+	FarSmoothLocationTime = 0.25f;
+
+	bUseSnapshotInterpolation = true;
+	MinInterpolationDelay = 0.05f;
+	MaxInterpolationDelay = 0.3f;
+	JitterDelayScale = 2.f;
+	DelayAdaptSpeed = 2.f;
+	MaxExtrapolationTime = 0.2f;
+	ServerHistoryTime = 1.f;
+
+	ClockOffset = 0.f;
+	Jitter = 0.f;
+	SnapshotInterval = 0.f;
+	InterpolationDelay = 0.f;
+	RenderTimestamp = 0.f;
+}
+
+void UCyclopeCharacterMovementComponent::BeginPlay()
+{
+	Super::BeginPlay();
+
+	// Snapshots are stamped with this, the engine only replicates it for linear smoothing by default
+	bNetworkAlwaysReplicateTransformUpdateTimestamp |= bUseSnapshotInterpolation;
+}
+
+void UCyclopeCharacterMovementComponent::TickComponent(float DeltaTime, ELevelTick TickType,
+	FActorComponentTickFunction* ThisTickFunction)
+{
+	Super::TickComponent(DeltaTime, TickType, ThisTickFunction);
+
+	if (CharacterOwner && CharacterOwner->GetLocalRole() == ROLE_SimulatedProxy && !IsUsingSnapshotInterpolation())
+	{
+		UpdateProxySmoothing();
+	}
+	else if (CharacterOwner && CharacterOwner->GetLocalRole() == ROLE_Authority && bUseSnapshotInterpolation)
+	{
+		RecordServerHistory();
+	}
+}
+
+void UCyclopeCharacterMovementComponent::SmoothCorrection(const FVector& OldLocation, const FQuat& OldRotation,
+	const FVector& NewLocation, const FQuat& NewRotation)
+{
+	const float Timestamp = CharacterOwner ? CharacterOwner->GetReplicatedServerLastTransformUpdateTimeStamp() : 0.f;
+	if (!IsUsingSnapshotInterpolation() || Timestamp <= 0.f)
+	{
+		Snapshots.Reset();
+		Super::SmoothCorrection(OldLocation, OldRotation, NewLocation, NewRotation);
+		return;
+	}
+
+	// Teleports and large corrections snap, like the engine smoothing, instead of sliding across the map
+	if (FVector::DistSquared(OldLocation, NewLocation) > FMath::Square(NetworkNoSmoothUpdateDistance))
+	{
+		Snapshots.Reset();
+		UpdatedComponent->SetWorldLocationAndRotation(NewLocation, NewRotation, false, nullptr,
+			ETeleportType::TeleportPhysics);
+		bNetworkSmoothingComplete = true;
+	}
+
+	// Otherwise the capsule stays where it is, ApplySnapshots moves it on the next tick
+	AddSnapshot(Timestamp, NewLocation, NewRotation);
+}
+
+void UCyclopeCharacterMovementComponent::SimulatedTick(float DeltaSeconds)
+{
+	if (!IsUsingSnapshotInterpolation() || Snapshots.Num() == 0)
+	{
+		Super::SimulatedTick(DeltaSeconds);
+		return;
+	}
+
+	ApplySnapshots(DeltaSeconds);
+}
+
+FNetworkPredictionData_Client* UCyclopeCharacterMovementComponent::GetPredictionData_Client() const
+{
+	if (ClientPredictionData == nullptr)
+	{
+		auto MutableThis = const_cast<UCyclopeCharacterMovementComponent*>(this);
+		MutableThis->ClientPredictionData = new FNetworkPredictionData_Client_Cyclope(*this);
+	}
+
+	return ClientPredictionData;
+}
+
+void UCyclopeCharacterMovementComponent::ServerMovePacked_ClientSend(const FCharacterServerMovePackedBits& PackedBits)
+{
+	INC_DWORD_STAT_BY(STAT_CyclopeMoveUpstreamBits, PackedBits.DataBits.Num());
+
+	Super::ServerMovePacked_ClientSend(PackedBits);
+}
+
+void UCyclopeCharacterMovementComponent::MoveResponsePacked_ServerSend(const FCharacterMoveResponsePackedBits& PackedBits)
+{
+	INC_DWORD_STAT_BY(STAT_CyclopeMoveDownstreamBits, PackedBits.DataBits.Num());
+
+	Super::MoveResponsePacked_ServerSend(PackedBits);
+}
+
+FVector UCyclopeCharacterMovementComponent::RoundAcceleration(FVector InAccel) const
+{
+	if (InAccel.IsNearlyZero())
+	{
+		return FVector::ZeroVector;
+	}
+
+	const float MaxAccel = GetMaxAcceleration();
+	uint16 Yaw;
+	uint8 Magnitude;
+	if (CyclopeMovement::PackPlanarAcceleration(InAccel, MaxAccel, Yaw, Magnitude))
+	{
+		return CyclopeMovement::UnpackPlanarAcceleration(Yaw, Magnitude, MaxAccel);
+	}
+
+	return Super::RoundAcceleration(InAccel);
+}
+
+void UCyclopeCharacterMovementComponent::SerializePackedAcceleration(FArchive& Ar, FVector& InOutAccel,
+	float MaxAccel)
+{
+	uint16 Yaw = 0;
+	uint8 Magnitude = 0;
+	uint8 Format = CyclopeMovement::Zero;
+
+	if (Ar.IsSaving() && !InOutAccel.IsNearlyZero())
+	{
+		Format = CyclopeMovement::PackPlanarAcceleration(InOutAccel, MaxAccel, Yaw, Magnitude)
+			? CyclopeMovement::Planar
+			: CyclopeMovement::Full;
+	}
+
+	Ar.SerializeBits(&Format, 2);
+
+	switch (Format)
+	{
+	case CyclopeMovement::Planar:
+		Ar << Yaw;
+		Ar << Magnitude;
+		InOutAccel = CyclopeMovement::UnpackPlanarAcceleration(Yaw, Magnitude, MaxAccel);
+		break;
+
+	case CyclopeMovement::Full:
+		{
+			bool bSuccess = true;
+			FVector_NetQuantize10 PackedAccel = InOutAccel;
+			PackedAccel.NetSerialize(Ar, nullptr, bSuccess);
+			InOutAccel = PackedAccel;
+		}
+		break;
+
+	default:
+		InOutAccel = FVector::ZeroVector;
+		break;
+	}
+}
+
+float UCyclopeCharacterMovementComponent::GetRenderTimestamp() const
+{
+	if (Snapshots.Num() > 0)
+	{
+		return RenderTimestamp;
+	}
+
+	// Engine smoothing converges on the newest update
+	return CharacterOwner ? CharacterOwner->GetReplicatedServerLastTransformUpdateTimeStamp() : 0.f;
+}
+
+bool UCyclopeCharacterMovementComponent::GetHistoricalLocation(float Timestamp, FVector& OutLocation) const
+{
+	// Claims older than the history or ahead of the server cannot be rewound, rather than judging
+	// them against the nearest sample
+	FCyclopeMovementSnapshot Sample;
+	if (Timestamp <= 0.f || ServerHistory.Num() == 0 || Timestamp < ServerHistory[0].Timestamp ||
+		Timestamp > ServerHistory.Last().Timestamp || !SampleSnapshots(ServerHistory, Timestamp, 0.f, Sample))
+	{
+		return false;
+	}
+
+	OutLocation = Sample.Location;
+	return true;
+}
+
+bool UCyclopeCharacterMovementComponent::IsUsingSnapshotInterpolation() const
+{
+	return bUseSnapshotInterpolation && CharacterOwner && CharacterOwner->GetLocalRole() == ROLE_SimulatedProxy &&
+		!GetWorld()->IsPlayingReplay();
+}
+
+void UCyclopeCharacterMovementComponent::AddSnapshot(float Timestamp, const FVector& Location, const FQuat& Rotation)
+{
+	const float LocalTime = GetWorld()->GetTimeSeconds();
+	const float Offset = LocalTime - Timestamp;
+
+	if (Snapshots.Num() > 0 && Timestamp <= Snapshots.Last().Timestamp)
+	{
+		// Duplicate, or the server timestamps were reset
+		if (Snapshots.Last().Timestamp - Timestamp < 1.f)
+		{
+			return;
+		}
+		Snapshots.Reset();
+	}
+
+	if (Snapshots.Num() == 0)
+	{
+		// Drop any offset left by the engine smoothing, the capsule itself is moved from now on
+		if (const auto Mesh = CharacterOwner->GetMesh())
+		{
+			Mesh->SetRelativeLocationAndRotation(CharacterOwner->GetBaseTranslationOffset(),
+				CharacterOwner->GetBaseRotationOffset());
+		}
+
+		ClockOffset = Offset;
+		Jitter = 0.f;
+		SnapshotInterval = MinInterpolationDelay;
+		InterpolationDelay = MinInterpolationDelay;
+	}
+	else
+	{
+		// Pauses in movement are not update intervals
+		const float Interval = FMath::Min(Timestamp - Snapshots.Last().Timestamp, MaxInterpolationDelay);
+		SnapshotInterval = FMath::Lerp(SnapshotInterval, Interval, 0.1f);
+
+		// The offset drops at once for an early update and creeps up to follow clock drift
+		ClockOffset = FMath::Lerp(ClockOffset, Offset, Offset < ClockOffset ? 0.5f : 0.01f);
+		Jitter = FMath::Lerp(Jitter, FMath::Abs(Offset - ClockOffset), 0.1f);
+	}
+
+	FCyclopeMovementSnapshot Snapshot;
+	Snapshot.Timestamp = Timestamp;
+	Snapshot.Location = Location;
+	Snapshot.Rotation = Rotation;
+	Snapshot.Velocity = Velocity;
+	Snapshots.Add(Snapshot);
+
+	// Keep one snapshot older than the longest delay to interpolate from
+	const float OldestNeeded = Timestamp - MaxInterpolationDelay - MaxExtrapolationTime;
+	int32 NumToRemove = 0;
+	while (NumToRemove + 2 < Snapshots.Num() && Snapshots[NumToRemove + 1].Timestamp < OldestNeeded)
+	{
+		++NumToRemove;
+	}
+	Snapshots.RemoveAt(0, NumToRemove, false);
+}
+
+void UCyclopeCharacterMovementComponent::ApplySnapshots(float DeltaSeconds)
+{
+	const float TargetDelay = FMath::Clamp(SnapshotInterval + JitterDelayScale * Jitter, MinInterpolationDelay,
+		MaxInterpolationDelay);
+	InterpolationDelay = FMath::FInterpTo(InterpolationDelay, TargetDelay, DeltaSeconds, DelayAdaptSpeed);
+
+	// Never render backwards in time, a growing delay holds the proxy instead of rewinding it
+	const float NewRenderTimestamp = GetWorld()->GetTimeSeconds() - ClockOffset - InterpolationDelay;
+	RenderTimestamp = FMath::Max(RenderTimestamp, NewRenderTimestamp);
+	if (RenderTimestamp > Snapshots.Last().Timestamp + MaxExtrapolationTime || RenderTimestamp < Snapshots[0].Timestamp)
+	{
+		RenderTimestamp = NewRenderTimestamp;
+	}
+
+	FCyclopeMovementSnapshot Sample;
+	SampleSnapshots(Snapshots, RenderTimestamp, MaxExtrapolationTime, Sample);
+
+	const bool bExtrapolating = RenderTimestamp > Snapshots.Last().Timestamp;
+	if (bExtrapolating)
+	{
+		INC_DWORD_STAT(STAT_CyclopeProxyExtrapolated);
+	}
+	SET_FLOAT_STAT(STAT_CyclopeProxyDelay, InterpolationDelay * 1000.f);
+	SET_FLOAT_STAT(STAT_CyclopeProxyJitter, Jitter * 1000.f);
+
+	// Extrapolated positions are guesses, do not push them through walls
+	UpdatedComponent->SetWorldLocationAndRotation(Sample.Location, Sample.Rotation, bExtrapolating, nullptr,
+		ETeleportType::TeleportPhysics);
+	Velocity = Sample.Velocity;
+	bNetworkSmoothingComplete = true;
+}
+
+bool UCyclopeCharacterMovementComponent::SampleSnapshots(const TArray<FCyclopeMovementSnapshot>& Buffer,
+	float Timestamp, float MaxExtrapolation, FCyclopeMovementSnapshot& OutSample)
+{
+	if (Buffer.Num() == 0)
+	{
+		return false;
+	}
+
+	if (Timestamp <= Buffer[0].Timestamp)
+	{
+		OutSample = Buffer[0];
+		return true;
+	}
+
+	const auto& Newest = Buffer.Last();
+	if (Timestamp >= Newest.Timestamp)
+	{
+		OutSample = Newest;
+		OutSample.Location += Newest.Velocity * FMath::Min(Timestamp - Newest.Timestamp, MaxExtrapolation);
+		return true;
+	}
+
+	int32 Idx = Buffer.Num() - 2;
+	while (Idx > 0 && Buffer[Idx].Timestamp > Timestamp)
+	{
+		--Idx;
+	}
+
+	const auto& From = Buffer[Idx];
+	const auto& To = Buffer[Idx + 1];
+	const float Alpha = (Timestamp - From.Timestamp) / FMath::Max(To.Timestamp - From.Timestamp, KINDA_SMALL_NUMBER);
+
+	OutSample.Timestamp = Timestamp;
+	OutSample.Location = FMath::Lerp(From.Location, To.Location, Alpha);
+	OutSample.Rotation = FQuat::Slerp(From.Rotation, To.Rotation, Alpha);
+	OutSample.Velocity = FMath::Lerp(From.Velocity, To.Velocity, Alpha);
+	return true;
+}
+
+void UCyclopeCharacterMovementComponent::RecordServerHistory()
+{
+	const float Timestamp = GetServerLastTransformUpdateTimeStamp();
+	if (Timestamp <= 0.f || !UpdatedComponent)
+	{
+		return;
+	}
+
+	if (ServerHistory.Num() > 0)
+	{
+		if (Timestamp == ServerHistory.Last().Timestamp)
+		{
+			return;
+		}
+		if (Timestamp < ServerHistory.Last().Timestamp)
+		{
+			ServerHistory.Reset();
+		}
+	}
+
+	FCyclopeMovementSnapshot Snapshot;
+	Snapshot.Timestamp = Timestamp;
+	Snapshot.Location = UpdatedComponent->GetComponentLocation();
+	Snapshot.Rotation = UpdatedComponent->GetComponentQuat();
+	Snapshot.Velocity = Velocity;
+	ServerHistory.Add(Snapshot);
+
+	int32 NumToRemove = 0;
+	while (NumToRemove + 2 < ServerHistory.Num() &&
+		ServerHistory[NumToRemove + 1].Timestamp < Timestamp - ServerHistoryTime)
+	{
+		++NumToRemove;
+	}
+	ServerHistory.RemoveAt(0, NumToRemove, false);
+}
+
+void UCyclopeCharacterMovementComponent::UpdateProxySmoothing()
+{
+	const auto LocalPC = GEngine->GetFirstLocalPlayerController(GetWorld());
+	if (!LocalPC)
+	{
+		return;
+	}
+
+	FVector ViewLocation;
+	FRotator ViewRotation;
+	LocalPC->GetPlayerViewPoint(ViewLocation, ViewRotation);
+
+	const float Distance = FVector::Dist(GetActorLocation(), ViewLocation);
+	const float Alpha = FMath::GetRangePct(NearProxyDistance, FarProxyDistance, Distance);
+
+	NetworkSimulatedSmoothLocationTime = FMath::Lerp(NearSmoothLocationTime, FarSmoothLocationTime,
+		FMath::Clamp(Alpha, 0.f, 1.f));
+}
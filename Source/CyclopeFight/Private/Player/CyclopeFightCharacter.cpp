@@ -1,400 +1,651 @@
-// Copyright Epic Games, Inc. All Rights Reserved.
-
-
-#include "Player/CyclopeFightCharacter.h"
-
-#include "CyclopeFight.h"
-#include "Player/CyclopePlayerController.h"
-#include "Camera/CameraComponent.h"
-#include "Components/ArrowComponent.h"
-#include "Components/CapsuleComponent.h"
-#include "Components/InputComponent.h"
-#include "GameFramework/CharacterMovementComponent.h"
-#include "GameFramework/Controller.h"
-#include "GameFramework/SpringArmComponent.h"
-#include "NiagaraComponent.h"
-#include "NiagaraFunctionLibrary.h"
-#include "Components/WidgetComponent.h"
-#include "GameFramework/PlayerState.h"
-#include "Kismet/GameplayStatics.h"
-#include "Net/UnrealNetwork.h"
-
-//////////////////////////////////////////////////////////////////////////
-// ACyclopeFightCharacter
-
-ACyclopeFightCharacter::ACyclopeFightCharacter()
-{
-	// Replication
-	bReplicates = true;
-
-	// Set size for collision capsule
-	GetCapsuleComponent()->InitCapsuleSize(42.f, 96.0f);
-
-	// set our turn rates for input
-	BaseTurnRate = 45.f;
-	BaseLookUpRate = 45.f;
-
-	// Don't rotate when the controller rotates. Let that just affect the camera.
-	bUseControllerRotationPitch = false;
-	bUseControllerRotationYaw = false;
-	bUseControllerRotationRoll = false;
-
-	// Configure character movement
-	GetCharacterMovement()->bOrientRotationToMovement = true; // Character moves in the direction of input...	
-	GetCharacterMovement()->RotationRate = FRotator(0.0f, 540.0f, 0.0f); // ...at this rotation rate
-	GetCharacterMovement()->JumpZVelocity = 600.f;
-	GetCharacterMovement()->AirControl = 0.2f;
-
-	// Create a camera boom (pulls in towards the player if there is a collision)
-	CameraBoom = CreateDefaultSubobject<USpringArmComponent>(TEXT("CameraBoom"));
-	CameraBoom->SetupAttachment(RootComponent);
-	CameraBoom->TargetArmLength = 300.0f; // The camera follows at this distance behind the character	
-	CameraBoom->bUsePawnControlRotation = true; // Rotate the arm based on the controller
-
-	// Create a follow camera
-	FollowCamera = CreateDefaultSubobject<UCameraComponent>(TEXT("FollowCamera"));
-	FollowCamera->SetupAttachment(CameraBoom, USpringArmComponent::SocketName);
-	// Attach the camera to the end of the boom and let the boom adjust to match the controller orientation
-	FollowCamera->bUsePawnControlRotation = false; // Camera does not rotate relative to arm
-
-	// Create an ArrowComponent as laser FX spawn pivot
-	ShootDirectionArrow = CreateDefaultSubobject<UArrowComponent>(TEXT("ShootDirection"));
-	ShootDirectionArrow->SetupAttachment(RootComponent);
-
-	MaxHealth = 3.f;
-	LaserRange = 4000.f;
-	// Note: The skeletal mesh and anim blueprint references on the Mesh component (inherited from Character) 
-	// are set in the derived blueprint asset named MyCharacter (to avoid direct content references in C++)
-}
-
-void ACyclopeFightCharacter::BeginPlay()
-{
-	Super::BeginPlay();
-
-	Health = MaxHealth;
-}
-
-//////////////////////////////////////////////////////////////////////////
-// Input
-
-void ACyclopeFightCharacter::SetupPlayerInputComponent(class UInputComponent* PlayerInputComponent)
-{
-	// Set up gameplay key bindings
-	check(PlayerInputComponent);
-	PlayerInputComponent->BindAction("Jump", IE_Pressed, this, &ACharacter::Jump);
-	PlayerInputComponent->BindAction("Jump", IE_Released, this, &ACharacter::StopJumping);
-
-	PlayerInputComponent->BindAxis("MoveForward", this, &ACyclopeFightCharacter::MoveForward);
-	PlayerInputComponent->BindAxis("MoveRight", this, &ACyclopeFightCharacter::MoveRight);
-
-	// We have 2 versions of the rotation bindings to handle different kinds of devices differently
-	// "turn" handles devices that provide an absolute delta, such as a mouse.
-	// "turnrate" is for devices that we choose to treat as a rate of change, such as an analog joystick
-	PlayerInputComponent->BindAxis("Turn", this, &ACyclopeFightCharacter::LookRight);
-	PlayerInputComponent->BindAxis("TurnRate", this, &ACyclopeFightCharacter::TurnAtRate);
-	PlayerInputComponent->BindAxis("LookUp", this, &ACyclopeFightCharacter::LookUp);
-
-	PlayerInputComponent->BindAction("Shoot", IE_Pressed, this, &ACyclopeFightCharacter::Shoot);
-}
-
-void ACyclopeFightCharacter::TurnAtRate(float Rate)
-{
-	// calculate delta for this frame from the rate information
-	AddControllerYawInput(Rate * BaseTurnRate * GetWorld()->GetDeltaSeconds());
-}
-
-void ACyclopeFightCharacter::LookUp(float Rate)
-{
-	AddControllerPitchInput(Rate);
-	
-	FRotator Rotation{FRotator::ZeroRotator};
-	Rotation.Pitch = FMath::ClampAngle(CameraBoom->GetTargetRotation().Pitch, -60.f, 60.f);
-
-	ShootDirectionArrow->SetRelativeRotation(Rotation);
-}
-
-void ACyclopeFightCharacter::LookRight(float Rate)
-{
-	AddControllerYawInput(Rate);
-	
-	FRotator Rotation{FRotator::ZeroRotator};
-	Rotation.Pitch = FMath::ClampAngle(CameraBoom->GetTargetRotation().Pitch, -60.f, 60.f);
-
-	ShootDirectionArrow->SetRelativeRotation(Rotation);
-}
-
-
-void ACyclopeFightCharacter::MoveForward(float Value)
-{
-	if ((Controller != nullptr) && (Value != 0.0f))
-	{
-		// find out which way is forward
-		const FRotator Rotation = Controller->GetControlRotation();
-		const FRotator YawRotation(0, Rotation.Yaw, 0);
-
-		// get forward vector
-		const FVector Direction = FRotationMatrix(YawRotation).GetUnitAxis(EAxis::X);
-		AddMovementInput(Direction, Value);
-	}
-}
-
-void ACyclopeFightCharacter::MoveRight(float Value)
-{
-	if ((Controller != nullptr) && (Value != 0.0f))
-	{
-		// find out which way is right
-		const FRotator Rotation = Controller->GetControlRotation();
-		const FRotator YawRotation(0, Rotation.Yaw, 0);
-
-		// get right vector 
-		const FVector Direction = FRotationMatrix(YawRotation).GetUnitAxis(EAxis::Y);
-		// add movement in that direction
-		AddMovementInput(Direction, Value);
-	}
-}
-
-//////////////////////////////////////////////////////////////////////////
-// Replication
-
-void ACyclopeFightCharacter::GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeProps) const
-{
-	Super::GetLifetimeReplicatedProps(OutLifetimeProps);
-
-	DOREPLIFETIME(ACyclopeFightCharacter, Health);
-	DOREPLIFETIME_CONDITION(ACyclopeFightCharacter, HitNotify, COND_SkipOwner);
-}
-
-float ACyclopeFightCharacter::TakeDamage(float DamageAmount, const FDamageEvent& DamageEvent,
-                                         AController* EventInstigator, AActor* DamageCauser)
-{
-	if (DamageCauser->GetClass() == this->GetClass())
-	{
-		UE_LOG(LogCyclope, Log, TEXT("%s has taken %f damage from %s"), *GetNameSafe(this), DamageAmount,
-		       *GetNameSafe(DamageCauser));
-		Health -= 1.f;
-
-		if (Health <= 0)
-		{
-			const auto EnemyPC = Cast<ACyclopePlayerController>(EventInstigator);
-			if (EnemyPC)
-			{
-				EnemyPC->KilledByEnemy();
-			}
-
-			Destroy();
-		}
-	}
-	return 1.f;
-}
-
-void ACyclopeFightCharacter::UnPossessed()
-{
-	Super::UnPossessed();
-
-	Multicast_HideMesh();
-}
-
-void ACyclopeFightCharacter::Multicast_HideMesh_Implementation()
-{
-	SetActorHiddenInGame(true);
-}
-
-void ACyclopeFightCharacter::DoDamage(AActor* DamagedActor)
-{
-	FDamageEvent DamageEvent;
-	DamageEvent.DamageTypeClass = UDamageType::StaticClass();
-
-	DamagedActor->TakeDamage(1.f, DamageEvent, this->GetController(), this);
-}
-
-bool ACyclopeFightCharacter::ShouldDealDamage(const AActor* TestActor) const
-{
-	// if we're an actor on the server, or the actor's role is authoritative, we should register damage
-	if (TestActor)
-	{
-		if (GetNetMode() != NM_Client ||
-			TestActor->GetLocalRole() == ROLE_Authority ||
-			TestActor->GetTearOff())
-		{
-			return true;
-		}
-	}
-
-	return false;
-}
-
-void ACyclopeFightCharacter::OnRep_Health()
-{
-	if (IsLocallyControlled())
-	{
-		auto CyclopePC = Cast<ACyclopePlayerController>(Controller);
-		if (CyclopePC)
-		{
-			CyclopePC->HealthChangedNotify(Health / MaxHealth);
-		}
-	}
-}
-
-void ACyclopeFightCharacter::Shoot()
-{
-	const auto TraceDirection = this->ShootDirectionArrow->GetForwardVector();
-	const auto TraceStart = this->ShootDirectionArrow->GetComponentLocation();
-	const auto TraceEnd = TraceStart + TraceDirection * LaserRange;
-
-	const auto HitResult = EyeTrace(TraceStart, TraceEnd);
-
-	ProcessHit(HitResult, TraceStart, TraceDirection);
-}
-
-FHitResult ACyclopeFightCharacter::EyeTrace(const FVector& TraceStart, const FVector& TraceEnd) const
-{
-	FHitResult HitResult;
-	const FName TraceTag("LaserTrace");
-	GetWorld()->DebugDrawTraceTag = TraceTag;
-
-	FCollisionQueryParams Params;
-	Params.AddIgnoredActor(this);
-	Params.TraceTag = TraceTag;
-
-	GetWorld()->LineTraceSingleByChannel(HitResult, TraceStart, TraceEnd,
-	                                     ECollisionChannel::ECC_WorldDynamic, Params);
-
-	return HitResult;
-}
-
-void ACyclopeFightCharacter::ProcessHit(const FHitResult& Impact, const FVector& Origin, const FVector& ShootDir)
-{
-	if (IsLocallyControlled() && GetRemoteRole() == NM_Client)
-	{
-		// If we're a client and we've hit smth controlled by the server
-		if (Impact.GetActor() && Impact.GetActor()->GetRemoteRole() == ROLE_Authority)
-		{
-			Server_NotifyHit(Impact, ShootDir);
-		}
-		else if (!Impact.GetActor())
-		{
-			if (Impact.bBlockingHit)
-			{
-				Server_NotifyHit(Impact, ShootDir);
-			}
-			else
-			{
-				Server_NotifyMiss(ShootDir);
-			}
-		}
-	}
-
-	ProcessHit_Confirmed(Impact, Origin, ShootDir);
-}
-
-void ACyclopeFightCharacter::ProcessHit_Confirmed(const FHitResult& Impact, const FVector& Origin,
-                                                  const FVector& ShootDir)
-{
-	if (ShouldDealDamage(Impact.GetActor()))
-	{
-		DoDamage(Impact.GetActor());
-	}
-
-	// Play FX on remote clients
-	if (GetLocalRole() == ROLE_Authority)
-	{
-		HitNotify.Origin = Origin;
-		HitNotify.ShootDir = ShootDir;
-	}
-
-	// Play FX locally
-	if (GetNetMode() != NM_DedicatedServer)
-	{
-		if(Impact.bBlockingHit)
-		{
-			const FVector EndTrace = Origin + ShootDir * Impact.Distance;
-			SpawnLaserTrail(EndTrace);
-		}else
-		{
-			const FVector EndTrace = Origin + ShootDir * LaserRange;
-			SpawnLaserTrail(EndTrace);
-		}
-	}
-}
-
-
-void ACyclopeFightCharacter::Server_NotifyHit_Implementation(const FHitResult& Impact,
-                                                             FVector_NetQuantizeNormal ShootDir)
-{
-	if (GetInstigator() && (Impact.GetActor() || Impact.bBlockingHit))
-	{
-		if (!Impact.GetActor())
-		{
-			if (Impact.bBlockingHit)
-			{
-				ProcessHit_Confirmed(Impact, ShootDirectionArrow->GetComponentLocation(), ShootDir);
-			}
-			// Assume it told the truth about static things because they don't move and
-			// hit usually doesn't have significant gameplay implications
-		}
-		else if (Impact.GetActor()->IsRootComponentStatic() || Impact.GetActor()->IsRootComponentStationary())
-		{
-			ProcessHit_Confirmed(Impact, ShootDirectionArrow->GetComponentLocation(), ShootDir);
-		}
-		else
-		{
-			ProcessHit_Confirmed(Impact, ShootDirectionArrow->GetComponentLocation(), ShootDir);
-		}
-	}
-}
-
-void ACyclopeFightCharacter::Server_NotifyMiss_Implementation(FVector_NetQuantizeNormal ShootDir)
-{
-	// Play fx on remote clients
-	HitNotify.Origin = ShootDirectionArrow->GetComponentLocation();
-	HitNotify.ShootDir = ShootDir;
-
-	// Play fx locally
-	if (GetNetMode() != NM_DedicatedServer)
-	{
-		const FVector EndTrace = HitNotify.Origin + ShootDir * LaserRange;
-		SpawnLaserTrail(EndTrace);
-	}
-}
-
-
-void ACyclopeFightCharacter::OnRep_HitNotify()
-{
-	SimulateHit(HitNotify.Origin, HitNotify.ShootDir);
-}
-
-void ACyclopeFightCharacter::SimulateHit(const FVector& Origin, const FVector& ShootDir) const
-{
-	const auto TraceEnd = Origin + ShootDir * LaserRange;
-
-	const auto HitResult = EyeTrace(Origin, TraceEnd);
-
-	if (HitResult.bBlockingHit)
-	{
-		SpawnLaserTrail(Origin + ShootDir * HitResult.Distance);
-	}
-	else
-	{
-		SpawnLaserTrail(TraceEnd);
-	}
-}
-
-void ACyclopeFightCharacter::SpawnLaserTrail(const FVector& EndTrace) const
-{
-	if (LaserBeamSystem)
-	{
-		const auto Origin = ShootDirectionArrow->GetComponentLocation();
-
-		auto LaserBeamComp = UNiagaraFunctionLibrary::SpawnSystemAtLocation(this, LaserBeamSystem,
-		                                                                    Origin);
-		if (LaserBeamComp)
-		{
-			LaserBeamComp->SetVectorParameter(FName("LaserEnd"), EndTrace);
-		}
-	}
-}
-
-uint8 ACyclopeFightCharacter::GetMaxHealth() const
-{
-	return MaxHealth;
-}
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+
+#include "Player/CyclopeFightCharacter.h"
+
+#include "CyclopeFight.h"
+#include "FX/CyclopeLaserFXSubsystem.h"
+#include "Game/CyclopeArenaStreamingSubsystem.h"
+#include "Game/CyclopeNetBenchmarkSubsystem.h"
+#include "Game/CyclopeShotEventSubsystem.h"
+#include "Memory/CyclopeAllocTracker.h"
+#include "Player/CyclopeCharacterMovementComponent.h"
+#include "Player/CyclopePlayerController.h"
+#include "Camera/CameraComponent.h"
+#include "Components/ArrowComponent.h"
+#include "Components/CapsuleComponent.h"
+#include "Components/InputComponent.h"
+#include "Components/SkeletalMeshComponent.h"
+#include "GameFramework/CharacterMovementComponent.h"
+#include "GameFramework/Controller.h"
+#include "GameFramework/SpringArmComponent.h"
+#include "HAL/IConsoleManager.h"
+#include "Components/WidgetComponent.h"
+#include "GameFramework/PlayerState.h"
+#include "Kismet/GameplayStatics.h"
+#include "Net/UnrealNetwork.h"
+#include "NiagaraSystem.h"
+
+DECLARE_DWORD_COUNTER_STAT(TEXT("Net priority full"), STAT_CyclopeNetPriorityFull, STATGROUP_Cyclope);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Net priority reduced"), STAT_CyclopeNetPriorityReduced, STATGROUP_Cyclope);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Net priority combat"), STAT_CyclopeNetPriorityCombat, STATGROUP_Cyclope);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Server meshes evaluating pose"), STAT_CyclopeServerPoseMeshes, STATGROUP_Cyclope);
+
+static TAutoConsoleVariable<int32> CVarServerAnimPolicy(
+	TEXT("Cyclope.ServerAnimPolicy"),
+	1,
+	TEXT("1: dedicated servers skip pose evaluation of character meshes unless requested, 0: engine default.\n")
+	TEXT("Applies to characters spawned after the change."),
+	ECVF_Default);
+
+//////////////////////////////////////////////////////////////////////////
+// ACyclopeFightCharacter
+
+ACyclopeFightCharacter::ACyclopeFightCharacter(const FObjectInitializer& ObjectInitializer)
+	: Super(ObjectInitializer.SetDefaultSubobjectClass<UCyclopeCharacterMovementComponent>(
+		ACharacter::CharacterMovementComponentName))
+{
+	// Replication
+	bReplicates = true;
+
+	// Set size for collision capsule
+	GetCapsuleComponent()->InitCapsuleSize(42.f, 96.0f);
+
+	// set our turn rates for input
+	BaseTurnRate = 45.f;
+	BaseLookUpRate = 45.f;
+
+	// Don't rotate when the controller rotates. Let that just affect the camera.
+	bUseControllerRotationPitch = false;
+	bUseControllerRotationYaw = false;
+	bUseControllerRotationRoll = false;
+
+	// Configure character movement
+	GetCharacterMovement()->bOrientRotationToMovement = true; // Character moves in the direction of input...	
+	GetCharacterMovement()->RotationRate = FRotator(0.0f, 540.0f, 0.0f); // ...at this rotation rate
+	GetCharacterMovement()->JumpZVelocity = 600.f;
+	GetCharacterMovement()->AirControl = 0.2f;
+
+	// The server target creates the camera too, the Blueprint holds overrides for both
+	// components. BeginPlay deactivates them on dedicated servers
+	// Create a camera boom (pulls in towards the player if there is a collision)
+	CameraBoom = CreateDefaultSubobject<USpringArmComponent>(TEXT("CameraBoom"));
+	CameraBoom->SetupAttachment(RootComponent);
+	CameraBoom->TargetArmLength = 300.0f; // The camera follows at this distance behind the character	
+	CameraBoom->bUsePawnControlRotation = true; // Rotate the arm based on the controller
+
+	// Create a follow camera
+	FollowCamera = CreateDefaultSubobject<UCameraComponent>(TEXT("FollowCamera"));
+	FollowCamera->SetupAttachment(CameraBoom, USpringArmComponent::SocketName);
+	// Attach the camera to the end of the boom and let the boom adjust to match the controller orientation
+	FollowCamera->bUsePawnControlRotation = false; // Camera does not rotate relative to arm
+
+	// Create an ArrowComponent as laser FX spawn pivot
+	ShootDirectionArrow = CreateDefaultSubobject<UArrowComponent>(TEXT("ShootDirection"));
+	ShootDirectionArrow->SetupAttachment(RootComponent);
+
+	MaxHealth = 3.f;
+	LaserRange = 4000.f;
+
+	NetAimConeHalfAngle = 20.f;
+	NetNearDistance = 1500.f;
+	NetFarDistance = 6000.f;
+	NetReducedPriorityScale = 0.25f;
+	NetCombatPriorityScale = 4.f;
+	NetCombatBoostTime = 0.5f;
+	NetOcclusionCheckInterval = 0.25f;
+	LastCombatTime = -BIG_NUMBER;
+
+	bServerAnimPolicy = false;
+	ServerPoseRequests = 0;
+	// Note: The skeletal mesh and anim blueprint references on the Mesh component (inherited from Character) 
+	// are set in the derived blueprint asset named MyCharacter (to avoid direct content references in C++)
+}
+
+void ACyclopeFightCharacter::BeginPlay()
+{
+	Super::BeginPlay();
+
+	Health = MaxHealth;
+
+	if (GetNetMode() == NM_DedicatedServer)
+	{
+		// Nobody looks through a dedicated server's camera, stop the boom's collision probe
+		if (CameraBoom)
+		{
+			CameraBoom->Deactivate();
+		}
+		if (FollowCamera)
+		{
+			FollowCamera->Deactivate();
+		}
+
+		if (CVarServerAnimPolicy.GetValueOnGameThread() != 0)
+		{
+			ApplyServerAnimPolicy();
+		}
+	}
+}
+
+void ACyclopeFightCharacter::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	if (ServerPoseRequests > 0)
+	{
+		DEC_DWORD_STAT(STAT_CyclopeServerPoseMeshes);
+	}
+
+	Super::EndPlay(EndPlayReason);
+}
+
+//////////////////////////////////////////////////////////////////////////
+// Server animation
+
+void ACyclopeFightCharacter::ApplyServerAnimPolicy()
+{
+	// Hit detection only uses the capsule, nothing on the server needs the pose
+	bServerAnimPolicy = true;
+
+	auto MeshComp = GetMesh();
+	MeshComp->VisibilityBasedAnimTickOption = EVisibilityBasedAnimTickOption::OnlyTickPoseWhenRendered;
+	MeshComp->bEnableUpdateRateOptimizations = true;
+	MeshComp->SetComponentTickEnabled(false);
+}
+
+void ACyclopeFightCharacter::AcquireServerPose()
+{
+	if (!bServerAnimPolicy || ServerPoseRequests++ > 0)
+	{
+		return;
+	}
+
+	auto MeshComp = GetMesh();
+	MeshComp->VisibilityBasedAnimTickOption = EVisibilityBasedAnimTickOption::AlwaysTickPoseAndRefreshBones;
+	MeshComp->SetComponentTickEnabled(true);
+
+	// Bring the pose up to date right away instead of on the next tick
+	MeshComp->TickAnimation(0.f, false);
+	MeshComp->RefreshBoneTransforms();
+
+	INC_DWORD_STAT(STAT_CyclopeServerPoseMeshes);
+}
+
+void ACyclopeFightCharacter::ReleaseServerPose()
+{
+	if (!bServerAnimPolicy || ServerPoseRequests == 0 || --ServerPoseRequests > 0)
+	{
+		return;
+	}
+
+	ApplyServerAnimPolicy();
+
+	DEC_DWORD_STAT(STAT_CyclopeServerPoseMeshes);
+}
+
+//////////////////////////////////////////////////////////////////////////
+// Input
+
+void ACyclopeFightCharacter::SetupPlayerInputComponent(class UInputComponent* PlayerInputComponent)
+{
+	// Set up gameplay key bindings
+	check(PlayerInputComponent);
+	PlayerInputComponent->BindAction("Jump", IE_Pressed, this, &ACharacter::Jump);
+	PlayerInputComponent->BindAction("Jump", IE_Released, this, &ACharacter::StopJumping);
+
+	PlayerInputComponent->BindAxis("MoveForward", this, &ACyclopeFightCharacter::MoveForward);
+	PlayerInputComponent->BindAxis("MoveRight", this, &ACyclopeFightCharacter::MoveRight);
+
+	// We have 2 versions of the rotation bindings to handle different kinds of devices differently
+	// "turn" handles devices that provide an absolute delta, such as a mouse.
+	// "turnrate" is for devices that we choose to treat as a rate of change, such as an analog joystick
+	PlayerInputComponent->BindAxis("Turn", this, &ACyclopeFightCharacter::LookRight);
+	PlayerInputComponent->BindAxis("TurnRate", this, &ACyclopeFightCharacter::TurnAtRate);
+	PlayerInputComponent->BindAxis("LookUp", this, &ACyclopeFightCharacter::LookUp);
+
+	PlayerInputComponent->BindAction("Shoot", IE_Pressed, this, &ACyclopeFightCharacter::Shoot);
+}
+
+void ACyclopeFightCharacter::TurnAtRate(float Rate)
+{
+	// calculate delta for this frame from the rate information
+	AddControllerYawInput(Rate * BaseTurnRate * GetWorld()->GetDeltaSeconds());
+}
+
+void ACyclopeFightCharacter::LookUp(float Rate)
+{
+	AddControllerPitchInput(Rate);
+	
+	if (CameraBoom)
+	{
+		FRotator Rotation{FRotator::ZeroRotator};
+		Rotation.Pitch = FMath::ClampAngle(CameraBoom->GetTargetRotation().Pitch, -60.f, 60.f);
+
+		ShootDirectionArrow->SetRelativeRotation(Rotation);
+	}
+}
+
+void ACyclopeFightCharacter::LookRight(float Rate)
+{
+	AddControllerYawInput(Rate);
+	
+	if (CameraBoom)
+	{
+		FRotator Rotation{FRotator::ZeroRotator};
+		Rotation.Pitch = FMath::ClampAngle(CameraBoom->GetTargetRotation().Pitch, -60.f, 60.f);
+
+		ShootDirectionArrow->SetRelativeRotation(Rotation);
+	}
+}
+
+
+void ACyclopeFightCharacter::MoveForward(float Value)
+{
+	if ((Controller != nullptr) && (Value != 0.0f))
+	{
+		// find out which way is forward
+		const FRotator Rotation = Controller->GetControlRotation();
+		const FRotator YawRotation(0, Rotation.Yaw, 0);
+
+		// get forward vector
+		const FVector Direction = FRotationMatrix(YawRotation).GetUnitAxis(EAxis::X);
+		AddMovementInput(Direction, Value);
+	}
+}
+
+void ACyclopeFightCharacter::MoveRight(float Value)
+{
+	if ((Controller != nullptr) && (Value != 0.0f))
+	{
+		// find out which way is right
+		const FRotator Rotation = Controller->GetControlRotation();
+		const FRotator YawRotation(0, Rotation.Yaw, 0);
+
+		// get right vector 
+		const FVector Direction = FRotationMatrix(YawRotation).GetUnitAxis(EAxis::Y);
+		// add movement in that direction
+		AddMovementInput(Direction, Value);
+	}
+}
+
+//////////////////////////////////////////////////////////////////////////
+// Replication
+
+void ACyclopeFightCharacter::GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeProps) const
+{
+	Super::GetLifetimeReplicatedProps(OutLifetimeProps);
+
+	DOREPLIFETIME(ACyclopeFightCharacter, Health);
+}
+
+bool ACyclopeFightCharacter::IsNetRelevantFor(const AActor* RealViewer, const AActor* ViewTarget,
+                                              const FVector& SrcLocation) const
+{
+	if (!Super::IsNetRelevantFor(RealViewer, ViewTarget, SrcLocation))
+	{
+		return false;
+	}
+
+	const auto ViewerPC = Cast<ACyclopePlayerController>(RealViewer);
+	if (!ViewerPC || ViewTarget == this || IsOwnedBy(RealViewer) || ViewerPC->IsReplayRecorder())
+	{
+		return true;
+	}
+
+	const auto Streaming = GetWorld()->GetSubsystem<UCyclopeArenaStreamingSubsystem>();
+	return !Streaming || Streaming->IsLocationLoadedFor(GetActorLocation(), ViewerPC->NetConnection);
+}
+
+float ACyclopeFightCharacter::GetNetPriority(const FVector& ViewPos, const FVector& ViewDir, AActor* Viewer,
+                                             AActor* ViewTarget, UActorChannel* InChannel, float Time,
+                                             bool bLowBandwidth)
+{
+	const float Priority = Super::GetNetPriority(ViewPos, ViewDir, Viewer, ViewTarget, InChannel, Time,
+	                                             bLowBandwidth);
+
+	if (Viewer == this || ViewTarget == this)
+	{
+		return Priority;
+	}
+
+	// Characters that just fired or took damage go out at full rate to everyone
+	if (GetWorld()->GetTimeSeconds() - LastCombatTime < NetCombatBoostTime)
+	{
+		INC_DWORD_STAT(STAT_CyclopeNetPriorityCombat);
+		return Priority * NetCombatPriorityScale;
+	}
+
+	// Characters the viewer is aiming at or standing next to keep full rate, the rest lose the
+	// bandwidth competition and are updated less often
+	const FVector ToSelf = GetActorLocation() - ViewPos;
+	const float DistSq = ToSelf.SizeSquared();
+	const bool bNear = DistSq < FMath::Square(NetNearDistance);
+	const bool bInAimCone = FVector::DotProduct(ToSelf.GetSafeNormal(), ViewDir) >=
+		FMath::Cos(FMath::DegreesToRadians(NetAimConeHalfAngle));
+
+	if (bNear || (bInAimCone && DistSq < FMath::Square(NetFarDistance) && !IsOccludedFrom(Viewer, ViewTarget, ViewPos)))
+	{
+		INC_DWORD_STAT(STAT_CyclopeNetPriorityFull);
+		return Priority;
+	}
+
+	INC_DWORD_STAT(STAT_CyclopeNetPriorityReduced);
+	return Priority * NetReducedPriorityScale;
+}
+
+bool ACyclopeFightCharacter::IsOccludedFrom(AActor* Viewer, AActor* ViewTarget, const FVector& ViewPos) const
+{
+	const float Now = GetWorld()->GetTimeSeconds();
+
+	auto& Entry = NetOcclusionCache.FindOrAdd(Viewer);
+	if (Now - Entry.LastCheckTime >= NetOcclusionCheckInterval)
+	{
+		FCollisionQueryParams Params(SCENE_QUERY_STAT(CyclopeNetOcclusion), false, this);
+		Params.AddIgnoredActor(Viewer);
+		Params.AddIgnoredActor(ViewTarget);
+
+		Entry.bOccluded = GetWorld()->LineTraceTestByChannel(ViewPos, GetActorLocation(), ECC_Visibility, Params);
+		Entry.LastCheckTime = Now;
+	}
+
+	return Entry.bOccluded;
+}
+
+void ACyclopeFightCharacter::MarkCombatActivity()
+{
+	LastCombatTime = GetWorld()->GetTimeSeconds();
+	ForceNetUpdate();
+}
+
+float ACyclopeFightCharacter::TakeDamage(float DamageAmount, const FDamageEvent& DamageEvent,
+                                         AController* EventInstigator, AActor* DamageCauser)
+{
+	CYCLOPE_SCOPE_ALLOCS();
+
+	if (DamageCauser->GetClass() == this->GetClass())
+	{
+		UE_LOG(LogCyclope, Log, TEXT("%s has taken %f damage from %s"), *GetNameSafe(this), DamageAmount,
+		       *GetNameSafe(DamageCauser));
+		Health -= 1.f;
+		MarkCombatActivity();
+
+		if (Health <= 0)
+		{
+			const auto EnemyPC = Cast<ACyclopePlayerController>(EventInstigator);
+			if (EnemyPC)
+			{
+				EnemyPC->KilledByEnemy();
+			}
+
+			Destroy();
+		}
+	}
+	return 1.f;
+}
+
+void ACyclopeFightCharacter::UnPossessed()
+{
+	Super::UnPossessed();
+
+	Multicast_HideMesh();
+}
+
+void ACyclopeFightCharacter::Multicast_HideMesh_Implementation()
+{
+	SetActorHiddenInGame(true);
+}
+
+void ACyclopeFightCharacter::DoDamage(AActor* DamagedActor)
+{
+	FDamageEvent DamageEvent;
+	DamageEvent.DamageTypeClass = UDamageType::StaticClass();
+
+	DamagedActor->TakeDamage(1.f, DamageEvent, this->GetController(), this);
+}
+
+bool ACyclopeFightCharacter::ShouldDealDamage(const AActor* TestActor) const
+{
+	// if we're an actor on the server, or the actor's role is authoritative, we should register damage
+	if (TestActor)
+	{
+		if (GetNetMode() != NM_Client ||
+			TestActor->GetLocalRole() == ROLE_Authority ||
+			TestActor->GetTearOff())
+		{
+			return true;
+		}
+	}
+
+	return false;
+}
+
+void ACyclopeFightCharacter::OnRep_Health()
+{
+	CYCLOPE_SCOPE_ALLOCS();
+
+#if !UE_SERVER
+	if (IsLocallyControlled())
+	{
+		auto CyclopePC = Cast<ACyclopePlayerController>(Controller);
+		if (CyclopePC)
+		{
+			CyclopePC->HealthChangedNotify(Health / MaxHealth);
+		}
+	}
+#endif
+}
+
+void ACyclopeFightCharacter::Shoot()
+{
+	CYCLOPE_SCOPE_ALLOCS();
+
+	const auto TraceDirection = this->ShootDirectionArrow->GetForwardVector();
+	const auto TraceStart = this->ShootDirectionArrow->GetComponentLocation();
+	const auto TraceEnd = TraceStart + TraceDirection * LaserRange;
+
+	const auto HitResult = EyeTrace(TraceStart, TraceEnd);
+
+	ProcessHit(HitResult, TraceStart, TraceDirection);
+}
+
+void ACyclopeFightCharacter::AimAt(const FVector& Target)
+{
+	const FRotator AimRotation = (Target - ShootDirectionArrow->GetComponentLocation()).Rotation();
+
+	SetActorRotation(FRotator(0.f, AimRotation.Yaw, 0.f));
+	ShootDirectionArrow->SetRelativeRotation(FRotator(FMath::ClampAngle(AimRotation.Pitch, -60.f, 60.f), 0.f, 0.f));
+}
+
+FHitResult ACyclopeFightCharacter::EyeTrace(const FVector& TraceStart, const FVector& TraceEnd) const
+{
+	FHitResult HitResult;
+	const FName TraceTag("LaserTrace");
+	GetWorld()->DebugDrawTraceTag = TraceTag;
+
+	FCollisionQueryParams Params;
+	Params.AddIgnoredActor(this);
+	Params.TraceTag = TraceTag;
+
+	GetWorld()->LineTraceSingleByChannel(HitResult, TraceStart, TraceEnd,
+	                                     ECollisionChannel::ECC_WorldDynamic, Params);
+
+	return HitResult;
+}
+
+void ACyclopeFightCharacter::ProcessHit(const FHitResult& Impact, const FVector& Origin, const FVector& ShootDir)
+{
+	if (IsLocallyControlled() && GetRemoteRole() == NM_Client)
+	{
+		// If we're a client and we've hit smth controlled by the server
+		if (Impact.GetActor() && Impact.GetActor()->GetRemoteRole() == ROLE_Authority)
+		{
+			// Tell the server which moment of the target's movement we were looking at
+			const auto Target = Cast<ACharacter>(Impact.GetActor());
+			const auto TargetMovement = Target
+				                            ? Cast<UCyclopeCharacterMovementComponent>(Target->GetCharacterMovement())
+				                            : nullptr;
+			const float TargetTimestamp = TargetMovement ? TargetMovement->GetRenderTimestamp() : 0.f;
+
+			if (auto NetBench = GetWorld()->GetSubsystem<UCyclopeNetBenchmarkSubsystem>())
+			{
+				NetBench->OnHitClaimed(Impact, TargetTimestamp);
+			}
+
+			Server_NotifyHit(Impact, ShootDir, TargetTimestamp);
+		}
+		else if (!Impact.GetActor())
+		{
+			if (Impact.bBlockingHit)
+			{
+				Server_NotifyHit(Impact, ShootDir, 0.f);
+			}
+			else
+			{
+				Server_NotifyMiss(ShootDir);
+			}
+		}
+	}
+
+	ProcessHit_Confirmed(Impact, Origin, ShootDir);
+}
+
+void ACyclopeFightCharacter::ProcessHit_Confirmed(const FHitResult& Impact, const FVector& Origin,
+                                                  const FVector& ShootDir)
+{
+	if (ShouldDealDamage(Impact.GetActor()))
+	{
+		DoDamage(Impact.GetActor());
+	}
+
+	// Play FX on remote clients
+	if (GetLocalRole() == ROLE_Authority)
+	{
+		NotifyShotFired(Origin, ShootDir);
+	}
+
+#if !UE_SERVER
+	// Play FX locally
+	if (GetNetMode() != NM_DedicatedServer)
+	{
+		if(Impact.bBlockingHit)
+		{
+			const FVector EndTrace = Origin + ShootDir * Impact.Distance;
+			SpawnLaserTrail(EndTrace);
+		}else
+		{
+			const FVector EndTrace = Origin + ShootDir * LaserRange;
+			SpawnLaserTrail(EndTrace);
+		}
+	}
+#endif
+}
+
+
+void ACyclopeFightCharacter::Server_NotifyHit_Implementation(const FHitResult& Impact,
+                                                             FVector_NetQuantizeNormal ShootDir, float TargetTimestamp)
+{
+	CYCLOPE_SCOPE_ALLOCS();
+
+	if (auto NetBench = GetWorld()->GetSubsystem<UCyclopeNetBenchmarkSubsystem>())
+	{
+		NetBench->OnServerHitReceived();
+	}
+
+	if (GetInstigator() && (Impact.GetActor() || Impact.bBlockingHit))
+	{
+		if (!Impact.GetActor())
+		{
+			if (Impact.bBlockingHit)
+			{
+				ProcessHit_Confirmed(Impact, ShootDirectionArrow->GetComponentLocation(), ShootDir);
+			}
+			// Assume it told the truth about static things because they don't move and
+			// hit usually doesn't have significant gameplay implications
+		}
+		else if (Impact.GetActor()->IsRootComponentStatic() || Impact.GetActor()->IsRootComponentStationary())
+		{
+			ProcessHit_Confirmed(Impact, ShootDirectionArrow->GetComponentLocation(), ShootDir);
+		}
+		else
+		{
+			ProcessHit_Confirmed(Impact, ShootDirectionArrow->GetComponentLocation(), ShootDir);
+		}
+	}
+}
+
+void ACyclopeFightCharacter::Server_NotifyMiss_Implementation(FVector_NetQuantizeNormal ShootDir)
+{
+	CYCLOPE_SCOPE_ALLOCS();
+
+	if (auto NetBench = GetWorld()->GetSubsystem<UCyclopeNetBenchmarkSubsystem>())
+	{
+		NetBench->OnServerMissReceived();
+	}
+
+	// Play fx on remote clients
+	const FVector Origin = ShootDirectionArrow->GetComponentLocation();
+	NotifyShotFired(Origin, ShootDir);
+
+#if !UE_SERVER
+	// Play fx locally
+	if (GetNetMode() != NM_DedicatedServer)
+	{
+		const FVector EndTrace = Origin + ShootDir * LaserRange;
+		SpawnLaserTrail(EndTrace);
+	}
+#endif
+}
+
+
+void ACyclopeFightCharacter::NotifyShotFired(const FVector& Origin, const FVector& ShootDir)
+{
+	MarkCombatActivity();
+
+	if (auto ShotEvents = GetWorld()->GetSubsystem<UCyclopeShotEventSubsystem>())
+	{
+		ShotEvents->QueueShot(this, Origin, ShootDir, LaserRange);
+	}
+}
+
+void ACyclopeFightCharacter::SimulateHit(const FVector& Origin, const FVector& ShootDir) const
+{
+	CYCLOPE_SCOPE_ALLOCS();
+
+	const auto TraceEnd = Origin + ShootDir * LaserRange;
+
+	const auto HitResult = EyeTrace(Origin, TraceEnd);
+
+	if (HitResult.bBlockingHit)
+	{
+		SpawnLaserTrail(Origin + ShootDir * HitResult.Distance);
+	}
+	else
+	{
+		SpawnLaserTrail(TraceEnd);
+	}
+}
+
+void ACyclopeFightCharacter::SpawnLaserTrail(const FVector& EndTrace) const
+{
+#if !UE_SERVER
+	// UCyclopeAssetPreloadSubsystem loads both systems. Never block a shot on them, until
+	// the preload is done there is simply no beam
+	auto LaserFX = GetWorld()->GetSubsystem<UCyclopeLaserFXSubsystem>();
+	auto BeamSystem = LaserBeamSystem.Get();
+	if (BeamSystem && LaserFX)
+	{
+		const auto Origin = ShootDirectionArrow->GetComponentLocation();
+
+		LaserFX->RequestBeam(BeamSystem, LowLaserBeamSystem.Get(), Origin, EndTrace, IsLocallyControlled());
+	}
+#endif
+}
+
+void ACyclopeFightCharacter::GetClientAssets(TArray<FSoftObjectPath>& OutAssets) const
+{
+	OutAssets.Add(LaserBeamSystem.ToSoftObjectPath());
+	OutAssets.Add(LowLaserBeamSystem.ToSoftObjectPath());
+}
+
+uint8 ACyclopeFightCharacter::GetMaxHealth() const
+{
+	return MaxHealth;
+}
@@ -1,5 +1,78 @@
-// Fill out your copyright notice in the Description page of Project Settings.
-
-
-#include "Player/CyclopeHUD.h"
-
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "Player/CyclopeHUD.h"
+
+#include "CyclopeFight.h"
+#include "Game/CyclopeFightGameState.h"
+#include "UI/CyclopeHUDWidget.h"
+
+ACyclopeHUD::ACyclopeHUD()
+{
+	HUDWidgetClass = UCyclopeHUDWidget::StaticClass();
+}
+
+void ACyclopeHUD::BeginPlay()
+{
+	Super::BeginPlay();
+
+#if !UE_SERVER
+	if (HasLegacyBlueprintHUD())
+	{
+		UE_LOG(LogCyclope, Warning, TEXT("%s still implements UpdateHealthBar, using its own health widget instead of %s"),
+		       *GetClass()->GetName(), *GetNameSafe(HUDWidgetClass));
+	}
+	else if (PlayerOwner && PlayerOwner->IsLocalController() && HUDWidgetClass)
+	{
+		HUDWidget = CreateWidget<UCyclopeHUDWidget>(PlayerOwner, HUDWidgetClass);
+		if (HUDWidget)
+		{
+			HUDWidget->AddToViewport();
+		}
+	}
+#endif
+
+	if (GetWorld()->GetGameState())
+	{
+		OnGameStateSet(GetWorld()->GetGameState());
+	}
+	else
+	{
+		GetWorld()->GameStateSetEvent.AddUObject(this, &ACyclopeHUD::OnGameStateSet);
+	}
+}
+
+bool ACyclopeHUD::HasLegacyBlueprintHUD() const
+{
+	return GetClass()->IsFunctionImplementedInScript(GET_FUNCTION_NAME_CHECKED(ACyclopeHUD, UpdateHealthBar));
+}
+
+void ACyclopeHUD::SetHealthAlpha(float HealthAlpha)
+{
+	if (HUDWidget)
+	{
+		HUDWidget->SetHealthAlpha(HealthAlpha);
+	}
+	else if (HasLegacyBlueprintHUD())
+	{
+		UpdateHealthBar(HealthAlpha);
+	}
+}
+
+void ACyclopeHUD::UpdateScore(int32 Player1Score, int32 Player2Score)
+{
+	if (HUDWidget)
+	{
+		HUDWidget->SetScore(Player1Score, Player2Score);
+	}
+}
+
+void ACyclopeHUD::OnGameStateSet(AGameStateBase* GameState)
+{
+	auto AsCyclopeGS = Cast<ACyclopeFightGameState>(GameState);
+	if (AsCyclopeGS)
+	{
+		AsCyclopeGS->OnScoreUpdatedNative.AddUObject(this, &ACyclopeHUD::UpdateScore);
+		UpdateScore(AsCyclopeGS->Player1Score, AsCyclopeGS->Player2Score);
+	}
+}
@@ -1,126 +1,233 @@
-// Fill out your copyright notice in the Description page of Project Settings.
-
-
-#include "Player/CyclopePlayerController.h"
-
-#include "CyclopeFight.h"
-#include "Player/CyclopeFightCharacter.h"
-#include "Game/CyclopeFightGameMode.h"
-#include "Game/CyclopeFightGameState.h"
-#include "Player/CyclopeHUD.h"
-#include "Net/UnrealNetwork.h"
-
-ACyclopePlayerController::ACyclopePlayerController()
-{
-}
-
-void ACyclopePlayerController::BeginPlay()
-{
-	Super::BeginPlay();
-
-	GEngine->AddOnScreenDebugMessage(0, 10.f, FColor::Black,
-		FString::Printf(TEXT("Spawned PC %d"), UniquePlayerID));
-	
-}
-
-void ACyclopePlayerController::GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeProps) const
-{
-	Super::GetLifetimeReplicatedProps(OutLifetimeProps);
-
-	DOREPLIFETIME(ACyclopePlayerController, UniquePlayerID);
-}
-
-void ACyclopePlayerController::OnPossess(APawn* InPawn)
-{
-	Super::OnPossess(InPawn);
-	
-	OnPawnPossessed.Broadcast();
-	UE_LOG(LogCyclope, Log, TEXT("Possessed character"));
-}
-
-void ACyclopePlayerController::OnUnPossess()
-{
-	Super::OnUnPossess();
-
-	OnPawnUnPossessed.Broadcast();
-	
-}
-
-void ACyclopePlayerController::SetupInputComponent()
-{
-	Super::SetupInputComponent();
-
-	check(InputComponent);
-	InputComponent->BindAction("Respawn", IE_Pressed, this, &ACyclopePlayerController::TryToRespawn);
-}
-
-void ACyclopePlayerController::TryToRespawn()
-{
-	if(!HasAuthority())
-	{
-		if(!GetPawn())
-		{
-			RequestGMRespawn();
-		}else
-		{
-			GEngine->AddOnScreenDebugMessage(0, 1.f, FColor::Red, "Already possessing");
-		}
-	}
-}
-
-float ACyclopePlayerController::GetMaxHealth() const
-{
-	if(GetPawn())
-	{
-		return Cast<ACyclopeFightCharacter>(GetPawn())->GetMaxHealth();
-	}
-	
-	return 0.f;
-}
-
-void ACyclopePlayerController::SetPlayerID(int32 ID)
-{
-	UniquePlayerID = ID;
-}
-
-int32 ACyclopePlayerController::GetPlayerID() const
-{
-	return UniquePlayerID;
-}
-
-void ACyclopePlayerController::HealthChangedNotify(float HealthAlpha) const
-{
-	auto AsCyclopeHUD = Cast<ACyclopeHUD>(MyHUD);
-
-	if(AsCyclopeHUD)
-	{
-		AsCyclopeHUD->UpdateHealthBar(HealthAlpha);
-	}
-}
-
-void ACyclopePlayerController::KilledByEnemy() const
-{
-	auto GS = Cast<ACyclopeFightGameState>(GetWorld()->GetGameState());
-
-	if(GS)
-	{
-		GS->AddScore(UniquePlayerID == 0);
-	}
-}
-
-void ACyclopePlayerController::RequestGMRespawn_Implementation()
-{
-	if(GetLocalRole() == ROLE_Authority)
-	{
-		auto GM = GetWorld()->GetAuthGameMode();
-		if(GM)
-		{
-			auto AsCyclopeGM = Cast<ACyclopeFightGameMode>(GM);
-
-			if(AsCyclopeGM)
-			{
-				AsCyclopeGM->Respawn(this);
-			}
-		}
-	}
-}
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "Player/CyclopePlayerController.h"
+
+#include "CyclopeFight.h"
+#include "Player/CyclopeFightCharacter.h"
+#include "Game/CyclopeAssetPreloadSubsystem.h"
+#include "Game/CyclopeFightGameMode.h"
+#include "Game/CyclopeFightGameState.h"
+#include "Game/CyclopeNetBenchmarkSubsystem.h"
+#include "Memory/CyclopeAllocTracker.h"
+#include "Player/CyclopeHUD.h"
+#include "Engine/DemoNetDriver.h"
+#include "Engine/GameInstance.h"
+#include "Engine/NetConnection.h"
+#include "Misc/NetworkVersion.h"
+#include "NetworkReplayStreaming.h"
+#include "Net/UnrealNetwork.h"
+
+ACyclopePlayerController::ACyclopePlayerController()
+{
+}
+
+void ACyclopePlayerController::BeginPlay()
+{
+	Super::BeginPlay();
+
+#if !UE_SERVER
+	GEngine->AddOnScreenDebugMessage(0, 10.f, FColor::Black,
+		FString::Printf(TEXT("Spawned PC %d"), UniquePlayerID));
+#endif
+	
+}
+
+void ACyclopePlayerController::ClientSetHUD_Implementation(TSubclassOf<AHUD> NewHUDClass)
+{
+	auto Preload = GetGameInstance() ? GetGameInstance()->GetSubsystem<UCyclopeAssetPreloadSubsystem>() : nullptr;
+	auto PreloadedHUDClass = Preload ? Preload->GetHUDClass() : nullptr;
+	if(NewHUDClass == ACyclopeHUD::StaticClass() && PreloadedHUDClass)
+	{
+		NewHUDClass = PreloadedHUDClass;
+	}
+
+	Super::ClientSetHUD_Implementation(NewHUDClass);
+}
+
+bool ACyclopePlayerController::IsReplayRecorder() const
+{
+	const auto DemoDriver = GetWorld() ? GetWorld()->GetDemoNetDriver() : nullptr;
+	return DemoDriver && NetConnection && NetConnection->GetDriver() == DemoDriver;
+}
+
+void ACyclopePlayerController::WatchLatestReplay()
+{
+	ReplayEnumerator = FNetworkReplayStreaming::Get().GetFactory().CreateReplayStreamer();
+	if (!ReplayEnumerator.IsValid())
+	{
+		UE_LOG(LogCyclope, Warning, TEXT("No replay streamer to list replays with"));
+		return;
+	}
+
+	ReplayEnumerator->EnumerateStreams(FNetworkVersion::GetReplayVersion(), INDEX_NONE, FString(), TArray<FString>(),
+		FEnumerateStreamsCallback::CreateUObject(this, &ACyclopePlayerController::OnReplaysEnumerated));
+}
+
+void ACyclopePlayerController::OnReplaysEnumerated(const FEnumerateStreamsResult& Result)
+{
+	const FNetworkReplayStreamInfo* Latest = nullptr;
+	for (const auto& Stream : Result.FoundStreams)
+	{
+		if (!Latest || Stream.Timestamp > Latest->Timestamp)
+		{
+			Latest = &Stream;
+		}
+	}
+
+	if (!Latest)
+	{
+		UE_LOG(LogCyclope, Warning, TEXT("No replay to watch"));
+		return;
+	}
+
+	UE_LOG(LogCyclope, Log, TEXT("Watching replay %s (%s)"), *Latest->Name, Latest->bIsLive ? TEXT("live") : TEXT("final"));
+	GetGameInstance()->PlayReplay(Latest->Name);
+}
+
+void ACyclopePlayerController::GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeProps) const
+{
+	Super::GetLifetimeReplicatedProps(OutLifetimeProps);
+
+	DOREPLIFETIME(ACyclopePlayerController, UniquePlayerID);
+}
+
+void ACyclopePlayerController::OnPossess(APawn* InPawn)
+{
+	Super::OnPossess(InPawn);
+	
+	OnPawnPossessed.Broadcast();
+	UE_LOG(LogCyclope, Log, TEXT("Possessed character"));
+}
+
+void ACyclopePlayerController::OnUnPossess()
+{
+	Super::OnUnPossess();
+
+	OnPawnUnPossessed.Broadcast();
+	
+}
+
+void ACyclopePlayerController::SetupInputComponent()
+{
+	Super::SetupInputComponent();
+
+	check(InputComponent);
+	InputComponent->BindAction("Respawn", IE_Pressed, this, &ACyclopePlayerController::TryToRespawn);
+}
+
+void ACyclopePlayerController::TryToRespawn()
+{
+	if(!HasAuthority())
+	{
+		if(!GetPawn())
+		{
+			RequestGMRespawn();
+		}else
+		{
+#if !UE_SERVER
+			GEngine->AddOnScreenDebugMessage(0, 1.f, FColor::Red, "Already possessing");
+#endif
+		}
+	}
+}
+
+float ACyclopePlayerController::GetMaxHealth() const
+{
+	if(GetPawn())
+	{
+		return Cast<ACyclopeFightCharacter>(GetPawn())->GetMaxHealth();
+	}
+	
+	return 0.f;
+}
+
+void ACyclopePlayerController::SetPlayerID(int32 ID)
+{
+	UniquePlayerID = ID;
+}
+
+int32 ACyclopePlayerController::GetPlayerID() const
+{
+	return UniquePlayerID;
+}
+
+void ACyclopePlayerController::HealthChangedNotify(float HealthAlpha) const
+{
+#if !UE_SERVER
+	auto AsCyclopeHUD = Cast<ACyclopeHUD>(MyHUD);
+
+	if(AsCyclopeHUD)
+	{
+		AsCyclopeHUD->SetHealthAlpha(HealthAlpha);
+	}
+#endif
+}
+
+void ACyclopePlayerController::KilledByEnemy() const
+{
+	auto GS = Cast<ACyclopeFightGameState>(GetWorld()->GetGameState());
+
+	if(GS)
+	{
+		GS->AddScore(UniquePlayerID == 0);
+	}
+}
+
+void ACyclopePlayerController::RequestGMRespawn_Implementation()
+{
+	if(GetLocalRole() == ROLE_Authority)
+	{
+		auto GM = GetWorld()->GetAuthGameMode();
+		if(GM)
+		{
+			auto AsCyclopeGM = Cast<ACyclopeFightGameMode>(GM);
+
+			if(AsCyclopeGM)
+			{
+				AsCyclopeGM->Respawn(this);
+			}
+		}
+	}
+}
+
+void ACyclopePlayerController::Server_BenchHitClaimed_Implementation(uint16 ClaimId, const FHitResult& Impact,
+	float TargetTimestamp)
+{
+	auto NetBench = GetWorld()->GetSubsystem<UCyclopeNetBenchmarkSubsystem>();
+	if(NetBench)
+	{
+		NetBench->OnServerHitClaimed(this, ClaimId, Impact, TargetTimestamp);
+	}
+}
+
+void ACyclopePlayerController::Client_BenchHitConfirmed_Implementation(uint16 ClaimId, bool bServerAgreed)
+{
+	auto NetBench = GetWorld()->GetSubsystem<UCyclopeNetBenchmarkSubsystem>();
+	if(NetBench)
+	{
+		NetBench->OnHitConfirmed(ClaimId, bServerAgreed);
+	}
+}
+
+void ACyclopePlayerController::Client_BenchProfileChanged_Implementation(uint8 ProfileIdx)
+{
+	auto NetBench = GetWorld()->GetSubsystem<UCyclopeNetBenchmarkSubsystem>();
+	if(NetBench)
+	{
+		NetBench->OnProfileChanged(ProfileIdx);
+	}
+}
+
+void ACyclopePlayerController::Client_ReceiveLaserShots_Implementation(const TArray<FLaserShotEvent>& Shots)
+{
+	CYCLOPE_SCOPE_ALLOCS();
+
+	for(const auto& Shot : Shots)
+	{
+		if(Shot.Shooter)
+		{
+			Shot.Shooter->SimulateHit(Shot.Origin, Shot.ShootDir);
+		}
+	}
+}
@@ -0,0 +1,94 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "UI/CyclopeHUDWidget.h"
+
+#include "Blueprint/WidgetTree.h"
+#include "Components/InvalidationBox.h"
+#include "Components/ProgressBar.h"
+#include "Components/TextBlock.h"
+#include "Components/VerticalBox.h"
+#include "Components/VerticalBoxSlot.h"
+#include "TimerManager.h"
+
+UCyclopeHUDWidget::UCyclopeHUDWidget(const FObjectInitializer& ObjectInitializer)
+	: Super(ObjectInitializer)
+{
+	PendingHealthAlpha = ShownHealthAlpha = 1.f;
+	PendingPlayer1Score = PendingPlayer2Score = 0;
+	ShownPlayer1Score = ShownPlayer2Score = INDEX_NONE;
+	bFlushScheduled = false;
+
+	SetVisibility(ESlateVisibility::HitTestInvisible);
+}
+
+TSharedRef<SWidget> UCyclopeHUDWidget::RebuildWidget()
+{
+	if (WidgetTree && !WidgetTree->RootWidget)
+	{
+		auto Invalidation = WidgetTree->ConstructWidget<UInvalidationBox>(UInvalidationBox::StaticClass(),
+			TEXT("HUDInvalidation"));
+		Invalidation->SetCanCache(true);
+		WidgetTree->RootWidget = Invalidation;
+
+		auto Box = WidgetTree->ConstructWidget<UVerticalBox>(UVerticalBox::StaticClass(), TEXT("HUDBox"));
+		Invalidation->AddChild(Box);
+
+		ScoreText = WidgetTree->ConstructWidget<UTextBlock>(UTextBlock::StaticClass(), TEXT("ScoreText"));
+		Box->AddChildToVerticalBox(ScoreText)->SetHorizontalAlignment(HAlign_Center);
+
+		HealthBar = WidgetTree->ConstructWidget<UProgressBar>(UProgressBar::StaticClass(), TEXT("HealthBar"));
+		HealthBar->SetFillColorAndOpacity(FLinearColor::Red);
+		Box->AddChildToVerticalBox(HealthBar)->SetPadding(FMargin(20.f, 10.f));
+	}
+
+	auto Widget = Super::RebuildWidget();
+
+	// Widgets are recreated, so everything has to be pushed again
+	ShownHealthAlpha = -1.f;
+	ShownPlayer1Score = ShownPlayer2Score = INDEX_NONE;
+	Flush();
+
+	return Widget;
+}
+
+void UCyclopeHUDWidget::SetHealthAlpha(float HealthAlpha)
+{
+	PendingHealthAlpha = HealthAlpha;
+	ScheduleFlush();
+}
+
+void UCyclopeHUDWidget::SetScore(int32 Player1Score, int32 Player2Score)
+{
+	PendingPlayer1Score = Player1Score;
+	PendingPlayer2Score = Player2Score;
+	ScheduleFlush();
+}
+
+void UCyclopeHUDWidget::ScheduleFlush()
+{
+	if (!bFlushScheduled && GetWorld())
+	{
+		bFlushScheduled = true;
+		GetWorld()->GetTimerManager().SetTimerForNextTick(this, &UCyclopeHUDWidget::Flush);
+	}
+}
+
+void UCyclopeHUDWidget::Flush()
+{
+	bFlushScheduled = false;
+
+	if (HealthBar && PendingHealthAlpha != ShownHealthAlpha)
+	{
+		HealthBar->SetPercent(PendingHealthAlpha);
+		ShownHealthAlpha = PendingHealthAlpha;
+	}
+
+	if (ScoreText && (PendingPlayer1Score != ShownPlayer1Score || PendingPlayer2Score != ShownPlayer2Score))
+	{
+		ScoreText->SetText(FText::Format(NSLOCTEXT("CyclopeHUD", "Score", "{0} : {1}"),
+			PendingPlayer1Score, PendingPlayer2Score));
+		ShownPlayer1Score = PendingPlayer1Score;
+		ShownPlayer2Score = PendingPlayer2Score;
+	}
+}
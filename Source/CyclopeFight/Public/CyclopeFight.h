@@ -1,7 +1,10 @@
-// Copyright Epic Games, Inc. All Rights Reserved.
-
-#pragma once
-
-#include "CoreMinimal.h"
-
-DECLARE_LOG_CATEGORY_EXTERN(LogCyclope, Log, All);
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Stats/Stats.h"
+
+CYCLOPEFIGHT_API DECLARE_LOG_CATEGORY_EXTERN(LogCyclope, Log, All);
+
+DECLARE_STATS_GROUP(TEXT("Cyclope"), STATGROUP_Cyclope, STATCAT_Advanced);
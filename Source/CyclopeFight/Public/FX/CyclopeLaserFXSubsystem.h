@@ -0,0 +1,96 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "Tickable.h"
+#include "CyclopeLaserFXSubsystem.generated.h"
+
+class UNiagaraComponent;
+class UNiagaraSystem;
+
+USTRUCT()
+struct FLaserBeamRequest
+{
+	GENERATED_BODY()
+
+	UPROPERTY()
+	UNiagaraSystem* System{nullptr};
+
+	/** Cheaper representation used when the beam is not significant enough for System **/
+	UPROPERTY()
+	UNiagaraSystem* LowSystem{nullptr};
+
+	FVector Origin{FVector::ZeroVector};
+
+	FVector End{FVector::ZeroVector};
+
+	/** Shots fired by the local player always win the budget **/
+	bool bLocallyFired{false};
+
+	float Significance{0.f};
+};
+
+/**
+ * Client side significance manager for laser beam FX.
+ * Beams requested during a frame are ranked by screen relevance and distance
+ * to the local viewer, then spawned within a per effects quality budget.
+ */
+UCLASS(config=Game)
+class CYCLOPEFIGHT_API UCyclopeLaserFXSubsystem : public UWorldSubsystem, public FTickableGameObject
+{
+	GENERATED_BODY()
+
+public:
+	UCyclopeLaserFXSubsystem();
+
+	virtual bool ShouldCreateSubsystem(UObject* Outer) const override;
+	virtual void Deinitialize() override;
+
+	// FTickableGameObject interface
+	virtual void Tick(float DeltaTime) override;
+	virtual ETickableTickType GetTickableTickType() const override;
+	virtual bool IsTickable() const override;
+	virtual TStatId GetStatId() const override;
+	virtual UWorld* GetTickableGameObjectWorld() const override;
+	// End of FTickableGameObject interface
+
+	/** Queue a beam, it is spawned (or dropped) on the next subsystem tick **/
+	void RequestBeam(UNiagaraSystem* System, UNiagaraSystem* LowSystem, const FVector& Origin, const FVector& End,
+		bool bLocallyFired);
+
+	/** Max concurrent beams, indexed by sg.EffectsQuality **/
+	UPROPERTY(Config)
+	TArray<int32> MaxActiveBeamsPerQuality;
+
+	/** Max beams spawned in a single frame **/
+	UPROPERTY(Config)
+	int32 MaxSpawnsPerFrame;
+
+	/** Beams further than this from the viewer are not spawned at all **/
+	UPROPERTY(Config)
+	float MaxBeamDistance;
+
+	/** Beams below this significance use the cheap representation **/
+	UPROPERTY(Config)
+	float LowSignificanceThreshold;
+
+	/** Significance multiplier for beams outside of the view cone **/
+	UPROPERTY(Config)
+	float OffScreenScale;
+
+private:
+	/** Rate a beam in [0, 1] against the local viewer **/
+	float ComputeSignificance(const FLaserBeamRequest& Request, const FVector& ViewLocation,
+		const FVector& ViewDir, float CosHalfFOV) const;
+
+	int32 GetMaxActiveBeams() const;
+
+	UNiagaraComponent* SpawnBeam(UNiagaraSystem* System, const FLaserBeamRequest& Request) const;
+
+	UPROPERTY(Transient)
+	TArray<FLaserBeamRequest> PendingBeams;
+
+	TArray<TWeakObjectPtr<UNiagaraComponent>> ActiveBeams;
+};
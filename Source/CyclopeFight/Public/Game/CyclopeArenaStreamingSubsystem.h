@@ -0,0 +1,101 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "Tickable.h"
+#include "CyclopeArenaStreamingSubsystem.generated.h"
+
+class ULevelStreaming;
+class UNetConnection;
+
+/** A streamed sublevel covering one square of the arena grid **/
+struct FCyclopeArenaCell
+{
+	TWeakObjectPtr<ULevelStreaming> Level;
+	FIntPoint Coord{FIntPoint::ZeroValue};
+	FBox Bounds{ForceInit};
+
+	/** Client: when the current load or unload was requested, negative when settled **/
+	double RequestTime{-1.0};
+	bool bWantLoaded{false};
+
+	/** Client: worst frame and hitches while the current request was in flight **/
+	float WorstFrameMs{0.f};
+	int32 HitchFrames{0};
+};
+
+/**
+ * Streams arena cells around the local viewer. Cells are sublevels using the Blueprint
+ * streaming method and named <Anything>_Cell_<X>_<Y>, cell X, Y covers CellSize square
+ * units from X * CellSize, Y * CellSize. Servers keep every cell loaded, and only
+ * replicate characters to connections that have the character's cell visible.
+ * Clients measure load time, hitches and resident memory of every cell change.
+ */
+UCLASS(config=Game)
+class CYCLOPEFIGHT_API UCyclopeArenaStreamingSubsystem : public UWorldSubsystem, public FTickableGameObject
+{
+	GENERATED_BODY()
+
+public:
+	UCyclopeArenaStreamingSubsystem();
+
+	virtual void Deinitialize() override;
+
+	// FTickableGameObject interface
+	virtual void Tick(float DeltaTime) override;
+	virtual ETickableTickType GetTickableTickType() const override;
+	virtual TStatId GetStatId() const override;
+	virtual UWorld* GetTickableGameObjectWorld() const override;
+	// End of FTickableGameObject interface
+
+	/** Is Level one of the arena cells, by its name **/
+	static bool IsCellLevel(const ULevelStreaming* Level);
+
+	/** Server: has Connection made the cell containing Location visible. True outside of the grid **/
+	bool IsLocationLoadedFor(const FVector& Location, const UNetConnection* Connection) const;
+
+	UPROPERTY(Config)
+	float CellSize;
+
+	/** Client: cells closer than this to the viewer are loaded **/
+	UPROPERTY(Config)
+	float LoadRadius;
+
+	/** Client: cells further than this from the viewer are unloaded **/
+	UPROPERTY(Config)
+	float UnloadRadius;
+
+	/** Client: seconds between two evaluations of the wanted cells **/
+	UPROPERTY(Config)
+	float UpdateInterval;
+
+	/** Client: frames longer than this while streaming count as hitches **/
+	UPROPERTY(Config)
+	float HitchThresholdMs;
+
+private:
+	/** Find the cell sublevels of the world, once it has begun play **/
+	void GatherCells();
+
+	FIntPoint GetCellCoord(const FVector& Location) const;
+
+	void UpdateWantedCells();
+
+	/** Track in flight requests and log each one once it settles **/
+	void UpdatePendingCells(float DeltaTime);
+
+	void RequestCell(FCyclopeArenaCell& Cell, bool bLoad);
+
+	void WriteReport() const;
+
+	TArray<FCyclopeArenaCell> Cells;
+	TMap<FIntPoint, int32> CellIndices;
+
+	bool bCellsGathered;
+	float UpdateCooldown;
+
+	/** Settled requests: cell, load or unload, duration, worst frame, hitches, resident memory after **/
+	TArray<FString> ReportRows;
+};
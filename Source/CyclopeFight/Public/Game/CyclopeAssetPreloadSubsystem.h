@@ -0,0 +1,64 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/GameInstanceSubsystem.h"
+#include "CyclopeAssetPreloadSubsystem.generated.h"
+
+class AHUD;
+struct FStreamableHandle;
+
+/**
+ * Loads gameplay classes asynchronously while the first map loads, and logs the
+ * startup timeline: process start, map loaded, assets preloaded, ready for players.
+ * Client only assets (HUD, laser FX) are never requested on a dedicated server.
+ */
+UCLASS(config=Game)
+class CYCLOPEFIGHT_API UCyclopeAssetPreloadSubsystem : public UGameInstanceSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	UCyclopeAssetPreloadSubsystem();
+
+	virtual void Initialize(FSubsystemCollectionBase& Collection) override;
+	virtual void Deinitialize() override;
+
+	/** Pawn class for players. Loads synchronously if asked before the preload finished **/
+	UClass* GetCharacterClass();
+
+	/** Blueprint HUD class for local players if one is configured, always null on a dedicated server **/
+	UClass* GetHUDClass();
+
+	UPROPERTY(Config)
+	TSoftClassPtr<APawn> CharacterClass;
+
+	/** Replaces the native ACyclopeHUD when set, e.g. with the legacy CyclopeHUD_BP **/
+	UPROPERTY(Config)
+	TSoftClassPtr<AHUD> HUDClass;
+
+private:
+	void OnCharacterClassLoaded();
+	void OnPreloadComplete();
+	void OnPostLoadMap(UWorld* World);
+
+	/** Log the startup summary once the map is loaded and the preload is done **/
+	void TryMarkReady();
+
+	bool WantsClientAssets() const;
+
+	/** Cooked dedicated server: complain about client only assets that a hard reference loaded anyway **/
+	void CheckNoClientAssetsLoaded() const;
+
+	TSharedPtr<FStreamableHandle> CharacterHandle;
+	TSharedPtr<FStreamableHandle> ClientAssetsHandle;
+
+	FDelegateHandle PostLoadMapHandle;
+
+	/** Seconds since process start, negative until reached **/
+	double PreloadStartTime;
+	double PreloadEndTime;
+	double MapLoadedTime;
+	double ReadyTime;
+};
@@ -1,39 +1,90 @@
-// Copyright Epic Games, Inc. All Rights Reserved.
-
-#pragma once
-
-#include "CoreMinimal.h"
-#include "GameFramework/GameMode.h"
-#include "CyclopeFightGameMode.generated.h"
-
-class APlayerStart;
-
-UCLASS(minimalapi)
-class ACyclopeFightGameMode : public AGameMode
-{
-	GENERATED_BODY()
-
-public:
-	ACyclopeFightGameMode();
-
-	virtual void BeginPlay() override final;
-	virtual APlayerController* Login(UPlayer* NewPlayer, ENetRole InRemoteRole, const FString& Portal,
-		const FString& Options, const FUniqueNetIdRepl& UniqueId, FString& ErrorMessage) override final;
-
-	virtual AActor* ChoosePlayerStart_Implementation(AController* Player) override final;
-
-	UFUNCTION(Server, Reliable)
-	void Respawn(APlayerController* Player);
-	
-
-private:
-	UPROPERTY()
-	TArray<APlayerStart*> PlayerStarts;
-	
-	bool CollectedPlayerStarts;
-	// TArray<FName> PlayerTags;
-	int32 FreeID;
-};
-
-
-
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "GameFramework/GameMode.h"
+#include "CyclopeFightGameMode.generated.h"
+
+class APlayerStart;
+
+UCLASS(minimalapi)
+class ACyclopeFightGameMode : public AGameMode
+{
+	GENERATED_BODY()
+
+public:
+	ACyclopeFightGameMode();
+
+	virtual void BeginPlay() override final;
+	virtual void PreLogin(const FString& Options, const FString& Address, const FUniqueNetIdRepl& UniqueId,
+		FString& ErrorMessage) override final;
+	virtual APlayerController* Login(UPlayer* NewPlayer, ENetRole InRemoteRole, const FString& Portal,
+		const FString& Options, const FUniqueNetIdRepl& UniqueId, FString& ErrorMessage) override final;
+	virtual void Logout(AController* Exiting) override final;
+
+	/** Like the engine, minus streamed arena cells: each client loads those around its own view **/
+	virtual void ReplicateStreamingStatus(APlayerController* PC) override final;
+
+	virtual AActor* ChoosePlayerStart_Implementation(AController* Player) override final;
+	virtual UClass* GetDefaultPawnClassForController_Implementation(AController* InController) override final;
+
+	UFUNCTION(Server, Reliable)
+	void Respawn(APlayerController* Player);
+
+	/** Log resident memory of the process and the footprint of each character **/
+	static void LogMemoryFootprint(UWorld* World);
+
+protected:
+	/** Server tick rate while hibernating **/
+	UPROPERTY(Config)
+	int32 HibernationTickRate;
+
+	/** Dedicated server hibernates while it has fewer players than this **/
+	UPROPERTY(Config)
+	int32 HibernateBelowPlayers;
+
+	/** Seconds to wait for a woken up connection to finish logging in **/
+	UPROPERTY(Config)
+	float WakeGraceTime;
+
+	/** Record every match on a dedicated server, same as running it with -CyclopeReplay **/
+	UPROPERTY(Config)
+	bool bRecordReplays;
+
+	UPROPERTY(Config)
+	FString ReplayName;
+
+private:
+	/** Start recording the match through the demo net driver if enabled **/
+	void StartReplayRecording();
+
+	/** Hibernate or wake up depending on the number of players, ignoring Exiting **/
+	void UpdateHibernation(AController* Exiting = nullptr);
+
+	void EnterHibernation();
+
+	void ExitHibernation();
+
+	/** Disable ticking of pawns and their components, remembering what was ticking **/
+	void SuspendPawnTicks();
+
+	void ResumePawnTicks();
+
+	bool bHibernating;
+	int32 AwakeTickRate;
+	FTimerHandle WakeGraceTimer;
+
+	TArray<TWeakObjectPtr<AActor>> SuspendedActors;
+	TArray<TWeakObjectPtr<UActorComponent>> SuspendedComponents;
+
+	UPROPERTY()
+	TArray<APlayerStart*> PlayerStarts;
+	
+	bool CollectedPlayerStarts;
+	// TArray<FName> PlayerTags;
+	int32 FreeID;
+};
+
+
+
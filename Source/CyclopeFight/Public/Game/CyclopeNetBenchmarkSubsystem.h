@@ -0,0 +1,155 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "Tickable.h"
+#include "Net/CyclopePacketStatsComponent.h"
+#include "CyclopeNetBenchmarkSubsystem.generated.h"
+
+class ACyclopePlayerController;
+
+/** Scripted network conditions for one benchmark phase **/
+USTRUCT()
+struct FCyclopeNetProfile
+{
+	GENERATED_BODY()
+
+	UPROPERTY(Config)
+	FString Name;
+
+	/** One way latency in ms, applied to both directions on the server **/
+	UPROPERTY(Config)
+	int32 PktLag{0};
+
+	/** Jitter in ms on top of PktLag **/
+	UPROPERTY(Config)
+	int32 PktLagVariance{0};
+
+	/** Loss in percent, applied to both directions on the server **/
+	UPROPERTY(Config)
+	int32 PktLoss{0};
+
+	/** Seconds the profile stays active **/
+	UPROPERTY(Config)
+	float Duration{30.f};
+};
+
+/** Results gathered for one profile **/
+struct FCyclopeNetProfileResult
+{
+	/** Client side **/
+	int32 ShotsFired{0};
+	int32 HitsClaimed{0};
+	int32 HitsConfirmed{0};
+	int32 HitsAgreed{0};
+	int32 HitsLost{0};
+	TArray<float> ConfirmLatencies;
+
+	/** Server side **/
+	int32 HitsReceived{0};
+	int32 MissesReceived{0};
+	int32 HitsRewound{0};
+	double BytesIn{0.0};
+	double BytesOut{0.0};
+	double PlayerSeconds{0.0};
+	uint64 Packets{0};
+	uint64 RawBits{0};
+	uint64 WireBits{0};
+	double CodecSeconds{0.0};
+	double Seconds{0.0};
+	double GameThreadMs{0.0};
+	int32 Frames{0};
+	double ReplayBytes{0.0};
+};
+
+/**
+ * Hit registration benchmark, active when the process runs with -CyclopeNetBench.
+ * The server walks through the configured profiles and applies them through the
+ * net driver packet simulation. Clients aim at the other character and shoot on
+ * a fixed interval. Each side logs a per profile report and writes it as CSV.
+ * Hit claims are judged through bench only RPCs on the player controller, sent next
+ * to the gameplay ones, so matches played without the benchmark send nothing extra.
+ */
+UCLASS(config=Game)
+class CYCLOPEFIGHT_API UCyclopeNetBenchmarkSubsystem : public UWorldSubsystem, public FTickableGameObject
+{
+	GENERATED_BODY()
+
+public:
+	UCyclopeNetBenchmarkSubsystem();
+
+	virtual bool ShouldCreateSubsystem(UObject* Outer) const override;
+	virtual void Deinitialize() override;
+
+	// FTickableGameObject interface
+	virtual void Tick(float DeltaTime) override;
+	virtual ETickableTickType GetTickableTickType() const override;
+	virtual TStatId GetStatId() const override;
+	virtual UWorld* GetTickableGameObjectWorld() const override;
+	// End of FTickableGameObject interface
+
+	/** Client: a hit on a character is being sent to the server, send the claim for the server to judge **/
+	void OnHitClaimed(const FHitResult& Impact, float TargetTimestamp);
+
+	/** Client: the server answered the claim ClaimId **/
+	void OnHitConfirmed(uint16 ClaimId, bool bServerAgreed);
+
+	/** Client: the server moved on to ProfileIdx, claims still unanswered are lost **/
+	void OnProfileChanged(int32 ProfileIdx);
+
+	/**
+	 * Server: a client hit claim arrived, judged against the victim at TargetTimestamp when known.
+	 * Every claim gets an answer, not agreed when it cannot be judged.
+	 */
+	void OnServerHitClaimed(ACyclopePlayerController* ShooterPC, uint16 ClaimId, const FHitResult& Impact,
+		float TargetTimestamp);
+
+	/** Server: a client hit arrived through the gameplay RPC **/
+	void OnServerHitReceived();
+
+	/** Server: a client miss arrived **/
+	void OnServerMissReceived();
+
+	UPROPERTY(Config)
+	TArray<FCyclopeNetProfile> Profiles;
+
+	/** Seconds between scripted shots on each client **/
+	UPROPERTY(Config)
+	float ShotInterval;
+
+	/** Slack in cm around the victim capsule for the server to agree with a claimed hit **/
+	UPROPERTY(Config)
+	float AgreeTolerance;
+
+private:
+	void TickServer(float DeltaTime);
+	void TickClient(float DeltaTime);
+
+	void ApplyProfile(int32 ProfileIdx);
+
+	/** Move packet handler totals gathered since the last call into the profile results **/
+	void CollectPacketStats(int32 ProfileIdx);
+
+	/** Client: count the claims of the current profile that got no answer as lost **/
+	void DropPendingClaims();
+
+	void WriteReport(bool bServer) const;
+
+	bool IsServer() const;
+
+	TArray<FCyclopeNetProfileResult> Results;
+
+	/** Fire times of the current profile's hit claims awaiting confirmation, by claim id **/
+	TMap<uint16, double> PendingClaims;
+
+	uint16 NextClaimId;
+
+	int32 CurrentProfile;
+	float ProfileElapsed;
+	float ShotCooldown;
+	bool bFinished;
+
+	FCyclopePacketStats LastPacketStats;
+};
@@ -0,0 +1,69 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "Tickable.h"
+#include "CyclopeShotEventSubsystem.generated.h"
+
+class ACyclopeFightCharacter;
+class ACyclopePlayerController;
+
+/** A laser shot other clients may have to draw **/
+USTRUCT()
+struct FLaserShotEvent
+{
+	GENERATED_BODY()
+
+	UPROPERTY()
+	ACyclopeFightCharacter* Shooter{nullptr};
+
+	UPROPERTY()
+	FVector_NetQuantize Origin;
+
+	UPROPERTY()
+	FVector_NetQuantizeNormal ShootDir;
+
+	/** Server only: far end of the beam segment **/
+	FVector End{FVector::ZeroVector};
+};
+
+/**
+ * Server side interest management for laser shots. Shots confirmed during a
+ * frame are collected, then at the end of the frame each connection is sent,
+ * in a single RPC, only the shots whose beam segment passes within its
+ * relevance radius.
+ */
+UCLASS(config=Game)
+class CYCLOPEFIGHT_API UCyclopeShotEventSubsystem : public UWorldSubsystem, public FTickableGameObject
+{
+	GENERATED_BODY()
+
+public:
+	UCyclopeShotEventSubsystem();
+
+	virtual void Deinitialize() override;
+
+	// FTickableGameObject interface
+	virtual void Tick(float DeltaTime) override;
+	virtual ETickableTickType GetTickableTickType() const override;
+	virtual bool IsTickable() const override;
+	virtual TStatId GetStatId() const override;
+	virtual UWorld* GetTickableGameObjectWorld() const override;
+	// End of FTickableGameObject interface
+
+	/** Queue a shot for the end of frame send **/
+	void QueueShot(ACyclopeFightCharacter* Shooter, const FVector& Origin, const FVector& ShootDir, float Range);
+
+	/** Viewers further than this from a beam segment do not receive the shot **/
+	UPROPERTY(Config)
+	float ShotRelevanceRadius;
+
+private:
+	/** Shots a viewer should receive, owner's own shots excluded **/
+	void GatherShotsFor(const ACyclopePlayerController* PC, TArray<FLaserShotEvent>& OutShots) const;
+
+	UPROPERTY(Transient)
+	TArray<FLaserShotEvent> PendingShots;
+};
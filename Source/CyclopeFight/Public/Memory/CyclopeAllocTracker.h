@@ -0,0 +1,52 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+/** Allocation totals since the tracker was installed **/
+struct FCyclopeAllocCounts
+{
+	/** Every allocation of the process **/
+	uint64 Allocs{0};
+
+	/** Allocations made inside a CYCLOPE_SCOPE_ALLOCS, and their size **/
+	uint64 ModuleAllocs{0};
+	uint64 ModuleBytes{0};
+};
+
+/**
+ * Counts the allocations going through GMalloc. FMemory does not know which module
+ * is calling, so allocations are attributed to this module when they happen inside a
+ * CYCLOPE_SCOPE_ALLOCS on the same thread, placed on the entry points of our gameplay code.
+ * Installed once at module startup, it then forwards to the engine allocator for good.
+ */
+class CYCLOPEFIGHT_API FCyclopeAllocTracker
+{
+public:
+	/** Wrap GMalloc, does nothing when already installed **/
+	static void Install();
+
+	static bool IsInstalled();
+
+	static FCyclopeAllocCounts GetCounts();
+
+	static void EnterScope();
+	static void ExitScope();
+};
+
+struct FCyclopeAllocScope
+{
+	FCyclopeAllocScope()
+	{
+		FCyclopeAllocTracker::EnterScope();
+	}
+
+	~FCyclopeAllocScope()
+	{
+		FCyclopeAllocTracker::ExitScope();
+	}
+};
+
+/** Attribute the allocations of the enclosing scope, and of everything it calls, to this module **/
+#define CYCLOPE_SCOPE_ALLOCS() const FCyclopeAllocScope ANONYMOUS_VARIABLE(CyclopeAllocScope)
@@ -0,0 +1,176 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "Tickable.h"
+#include "UObject/UObjectArray.h"
+#include "Memory/CyclopeAllocTracker.h"
+#include "CyclopeMemoryBudgetSubsystem.generated.h"
+
+class UWorld;
+
+/** UObjects of one class created and destroyed during the match **/
+struct FCyclopeClassObjectCounts
+{
+	int32 Created{0};
+	int32 Destroyed{0};
+};
+
+/**
+ * Counts UObject creation and destruction by class, for the objects of one world. Objects are
+ * created on the loading thread too, so everything is behind a lock. Destruction is only counted
+ * for objects counted when created, their class and outers may already be gone when they are destroyed.
+ */
+class FCyclopeObjectCounter : public FUObjectArray::FUObjectCreateListener, public FUObjectArray::FUObjectDeleteListener
+{
+public:
+	FCyclopeObjectCounter();
+	virtual ~FCyclopeObjectCounter();
+
+	/**
+	 * Count the objects of World from now on. The listeners are process wide, in PIE they
+	 * also hear about the objects of the other worlds
+	 */
+	void StartListening(const UWorld* World);
+	void StopListening();
+
+	/** Forget every object counted so far **/
+	void Reset();
+
+	virtual void NotifyUObjectCreated(const UObjectBase* Object, int32 Index) override;
+	virtual void NotifyUObjectDeleted(const UObjectBase* Object, int32 Index) override;
+	virtual void OnUObjectArrayShutdown() override;
+
+	/** Creations and destructions since the last call **/
+	void ConsumeFrameCounts(int32& OutCreated, int32& OutDestroyed);
+
+	TMap<FName, FCyclopeClassObjectCounts> GetClassCounts() const;
+
+private:
+	bool IsInWorld(const UObjectBase* Object) const;
+
+	mutable FCriticalSection Lock;
+
+	TMap<FName, FCyclopeClassObjectCounts> ClassCounts;
+
+	/** Class of the live objects we saw created, by object index **/
+	TMap<int32, FName> LiveClasses;
+
+	int32 FrameCreated;
+	int32 FrameDestroyed;
+	bool bListening;
+
+	/** PIE instance of the packages of the counted world, INDEX_NONE outside of PIE **/
+	int32 PIEInstanceID;
+};
+
+/**
+ * Memory churn of a match: allocations per frame, in total and made by this module,
+ * UObjects created and destroyed by class, and GC pauses. Exposed as `stat Cyclope`,
+ * as CyclopeMemory in `csvprofile` captures, and written per class to
+ * Saved/Benchmarks/Memory_<pid>.csv when the match ends. Going over a budget logs a warning.
+ * Allocations and GC pauses belong to the process, not a world: when several game worlds share
+ * it, as in PIE, the first one measures them.
+ */
+UCLASS(config=Game)
+class CYCLOPEFIGHT_API UCyclopeMemoryBudgetSubsystem : public UWorldSubsystem, public FTickableGameObject
+{
+	GENERATED_BODY()
+
+public:
+	UCyclopeMemoryBudgetSubsystem();
+
+	virtual bool ShouldCreateSubsystem(UObject* Outer) const override;
+	virtual void Initialize(FSubsystemCollectionBase& Collection) override;
+	virtual void Deinitialize() override;
+	virtual void OnWorldBeginPlay(UWorld& InWorld) override;
+
+	// FTickableGameObject interface
+	virtual void Tick(float DeltaTime) override;
+	virtual ETickableTickType GetTickableTickType() const override;
+	virtual TStatId GetStatId() const override;
+	virtual UWorld* GetTickableGameObjectWorld() const override;
+	// End of FTickableGameObject interface
+
+	/**
+	 * Wrap the engine allocator at startup of game processes, read before any subsystem exists.
+	 * Every allocation of every thread then costs an atomic increment, which skews the other
+	 * benchmarks, so it is off unless memory is what is being measured
+	 */
+	UPROPERTY(Config)
+	bool bTrackAllocations;
+
+	/** Allocations of any module in one frame, zero for no budget **/
+	UPROPERTY(Config)
+	int32 MaxAllocsPerFrame;
+
+	/** Allocations made by our gameplay code in one frame, zero for no budget **/
+	UPROPERTY(Config)
+	int32 MaxModuleAllocsPerFrame;
+
+	/** UObjects created in one frame, zero for no budget **/
+	UPROPERTY(Config)
+	int32 MaxObjectsCreatedPerFrame;
+
+	/** Longest acceptable garbage collection, zero for no budget **/
+	UPROPERTY(Config)
+	float MaxGCPauseMs;
+
+	/** Seconds between two warnings about the same budget **/
+	UPROPERTY(Config)
+	float WarningInterval;
+
+private:
+	enum EBudget
+	{
+		Budget_Allocs,
+		Budget_ModuleAllocs,
+		Budget_ObjectsCreated,
+		Budget_GCPause,
+		Budget_Count
+	};
+
+	void OnPreGarbageCollect();
+	void OnPostGarbageCollect();
+
+	/** Count an overrun, and warn unless we did recently **/
+	void CheckBudget(EBudget Budget, double Value, double Limit, const TCHAR* What);
+
+	/** Forget everything counted so far, the next frame starts from zero **/
+	void ResetFrameCounters();
+
+	void LogSummary() const;
+	void WriteReport() const;
+
+	FCyclopeObjectCounter ObjectCounter;
+
+	FDelegateHandle PreGCHandle;
+	FDelegateHandle PostGCHandle;
+
+	FCyclopeAllocCounts LastAllocCounts;
+
+	/** Frames before this are map load, actor initialization and BeginPlay, not the match **/
+	bool bMatchStarted;
+
+	/** This world measures the process wide allocations and GC pauses **/
+	bool bMeasuresProcess;
+
+	/** Match totals **/
+	int64 NumFrames;
+	uint64 TotalAllocs;
+	uint64 PeakAllocs;
+	uint64 TotalModuleAllocs;
+	uint64 PeakModuleAllocs;
+	uint64 TotalModuleBytes;
+	int32 PeakObjectsCreated;
+
+	double GCStartTime;
+	int32 NumGCs;
+	double TotalGCMs;
+	double PeakGCMs;
+
+	int32 Overruns[Budget_Count];
+	double LastWarningTime[Budget_Count];
+};
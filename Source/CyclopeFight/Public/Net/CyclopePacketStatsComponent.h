@@ -0,0 +1,60 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "PacketHandler.h"
+
+/** Which side of the compression component an instance sits on **/
+enum class ECyclopePacketStatsStage : uint8
+{
+	/** Before compression on send, after decompression on receive **/
+	Raw,
+	/** What actually goes on the wire **/
+	Wire
+};
+
+/** Process wide packet compression totals **/
+struct CYCLOPEFIGHT_API FCyclopePacketStats
+{
+	uint64 Packets{0};
+	uint64 RawBits{0};
+	uint64 WireBits{0};
+
+	/** Time spent in the components between Raw and Wire, both directions **/
+	double CodecSeconds{0.0};
+
+	static FCyclopePacketStats& Get();
+};
+
+/**
+ * Measuring packet handler component. Listed once before and once after the
+ * compression component in [PacketHandlerComponents], it records raw and wire
+ * packet sizes and the time spent compressing and decompressing.
+ */
+class FCyclopePacketStatsComponent : public HandlerComponent
+{
+public:
+	explicit FCyclopePacketStatsComponent(ECyclopePacketStatsStage InStage);
+
+	virtual bool IsValid() const override;
+	virtual void Initialize() override;
+
+	virtual void Incoming(FBitReader& Packet) override;
+	virtual void Outgoing(FBitWriter& Packet, FOutPacketTraits& Traits) override;
+
+	virtual void IncomingConnectionless(const TSharedPtr<const FInternetAddr>& Address, FBitReader& Packet) override
+	{
+	}
+
+	virtual void OutgoingConnectionless(const TSharedPtr<const FInternetAddr>& Address, FBitWriter& Packet,
+		FOutPacketTraits& Traits) override
+	{
+	}
+
+	virtual bool CanReadUnaligned() const override;
+	virtual int32 GetReservedPacketBits() const override;
+
+private:
+	ECyclopePacketStatsStage Stage;
+};
@@ -0,0 +1,170 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "GameFramework/CharacterMovementComponent.h"
+#include "CyclopeCharacterMovementComponent.generated.h"
+
+/**
+ * Move data sent in packed movement RPCs. Acceleration and location are sent
+ * with less precision than the engine default: planar acceleration as a yaw
+ * and a fraction of max acceleration, location to a tenth of a centimeter.
+ */
+struct FCyclopeCharacterNetworkMoveData : public FCharacterNetworkMoveData
+{
+	typedef FCharacterNetworkMoveData Super;
+
+	virtual bool Serialize(UCharacterMovementComponent& CharacterMovement, FArchive& Ar, UPackageMap* PackageMap,
+		ENetworkMoveType MoveType) override;
+};
+
+struct FCyclopeCharacterNetworkMoveDataContainer : public FCharacterNetworkMoveDataContainer
+{
+	FCyclopeCharacterNetworkMoveDataContainer();
+
+	FCyclopeCharacterNetworkMoveData CyclopeMoveData[3];
+};
+
+/** Saved move that combines with its neighbours more eagerly than the engine default **/
+class FSavedMove_Cyclope : public FSavedMove_Character
+{
+public:
+	typedef FSavedMove_Character Super;
+
+	FSavedMove_Cyclope();
+};
+
+class FNetworkPredictionData_Client_Cyclope : public FNetworkPredictionData_Client_Character
+{
+public:
+	typedef FNetworkPredictionData_Client_Character Super;
+
+	FNetworkPredictionData_Client_Cyclope(const UCharacterMovementComponent& ClientMovement);
+
+	virtual FSavedMovePtr AllocateNewMove() override;
+};
+
+/** Replicated transform of a character at a server movement timestamp **/
+struct FCyclopeMovementSnapshot
+{
+	float Timestamp{0.f};
+	FVector Location{FVector::ZeroVector};
+	FQuat Rotation{FQuat::Identity};
+	FVector Velocity{FVector::ZeroVector};
+};
+
+/**
+ * Character movement tuned for bandwidth: tighter move packing, more aggressive
+ * move combining and smoothing of simulated proxies that tolerates low update rates.
+ *
+ * Simulated proxies are rendered from a snapshot buffer, a delay behind the newest
+ * update that adapts to the measured jitter, and extrapolate for a bounded time
+ * when updates are late. Snapshots are stamped with the server movement timestamp,
+ * the server keeps a short history on the same timeline to look up what a shooter saw.
+ */
+UCLASS(config=Game)
+class CYCLOPEFIGHT_API UCyclopeCharacterMovementComponent : public UCharacterMovementComponent
+{
+	GENERATED_BODY()
+
+public:
+	UCyclopeCharacterMovementComponent();
+
+	virtual void BeginPlay() override;
+	virtual void TickComponent(float DeltaTime, ELevelTick TickType,
+		FActorComponentTickFunction* ThisTickFunction) override;
+
+	virtual void SmoothCorrection(const FVector& OldLocation, const FQuat& OldRotation, const FVector& NewLocation,
+		const FQuat& NewRotation) override;
+
+	virtual FNetworkPredictionData_Client* GetPredictionData_Client() const override;
+
+	virtual void ServerMovePacked_ClientSend(const FCharacterServerMovePackedBits& PackedBits) override;
+	virtual void MoveResponsePacked_ServerSend(const FCharacterMoveResponsePackedBits& PackedBits) override;
+
+	/** Round acceleration to exactly what survives FCyclopeCharacterNetworkMoveData packing **/
+	virtual FVector RoundAcceleration(FVector InAccel) const override;
+
+	/** Write or read acceleration in packed form. Both sides must agree on MaxAccel **/
+	static void SerializePackedAcceleration(FArchive& Ar, FVector& InOutAccel, float MaxAccel);
+
+	/** Simulated proxy: server movement timestamp currently rendered, 0 when not known **/
+	float GetRenderTimestamp() const;
+
+	/** Server: where the character was at a movement timestamp reported by a client, false outside of the history **/
+	bool GetHistoricalLocation(float Timestamp, FVector& OutLocation) const;
+
+	/** Render simulated proxies from the snapshot buffer instead of the engine smoothing **/
+	UPROPERTY(Config, EditDefaultsOnly, Category="Character Movement (Networking)")
+	bool bUseSnapshotInterpolation;
+
+	UPROPERTY(Config, EditDefaultsOnly, Category="Character Movement (Networking)")
+	float MinInterpolationDelay;
+
+	UPROPERTY(Config, EditDefaultsOnly, Category="Character Movement (Networking)")
+	float MaxInterpolationDelay;
+
+	/** Interpolation delay is the update interval plus this many times the measured jitter **/
+	UPROPERTY(Config, EditDefaultsOnly, Category="Character Movement (Networking)")
+	float JitterDelayScale;
+
+	/** How fast the interpolation delay follows its target, per second **/
+	UPROPERTY(Config, EditDefaultsOnly, Category="Character Movement (Networking)")
+	float DelayAdaptSpeed;
+
+	/** Longest a proxy moves on from its newest snapshot before it stops and waits **/
+	UPROPERTY(Config, EditDefaultsOnly, Category="Character Movement (Networking)")
+	float MaxExtrapolationTime;
+
+	/** Seconds of movement history kept for hit claims on the server **/
+	UPROPERTY(Config, EditDefaultsOnly, Category="Character Movement (Networking)")
+	float ServerHistoryTime;
+
+	/** Distance from the local viewer below which simulated proxies use NearSmoothLocationTime **/
+	UPROPERTY(EditDefaultsOnly, Category="Character Movement (Networking)")
+	float NearProxyDistance;
+
+	/** Distance from the local viewer above which simulated proxies use FarSmoothLocationTime **/
+	UPROPERTY(EditDefaultsOnly, Category="Character Movement (Networking)")
+	float FarProxyDistance;
+
+	UPROPERTY(EditDefaultsOnly, Category="Character Movement (Networking)")
+	float NearSmoothLocationTime;
+
+	/** Distant proxies are updated less often, so they are smoothed over a longer window **/
+	UPROPERTY(EditDefaultsOnly, Category="Character Movement (Networking)")
+	float FarSmoothLocationTime;
+
+protected:
+	virtual void SimulatedTick(float DeltaSeconds) override;
+
+private:
+	/** Adjust simulated proxy smoothing to the distance from the local viewer **/
+	void UpdateProxySmoothing();
+
+	bool IsUsingSnapshotInterpolation() const;
+
+	void AddSnapshot(float Timestamp, const FVector& Location, const FQuat& Rotation);
+
+	/** Move the proxy to the buffered transform at the current render time **/
+	void ApplySnapshots(float DeltaSeconds);
+
+	void RecordServerHistory();
+
+	/** Transform at Timestamp, extrapolated from the newest snapshot for at most MaxExtrapolation **/
+	static bool SampleSnapshots(const TArray<FCyclopeMovementSnapshot>& Buffer, float Timestamp,
+		float MaxExtrapolation, FCyclopeMovementSnapshot& OutSample);
+
+	TArray<FCyclopeMovementSnapshot> Snapshots;
+	TArray<FCyclopeMovementSnapshot> ServerHistory;
+
+	/** Local time minus snapshot timestamp for an update that was not delayed **/
+	float ClockOffset;
+	float Jitter;
+	float SnapshotInterval;
+	float InterpolationDelay;
+	float RenderTimestamp;
+
+	FCyclopeCharacterNetworkMoveDataContainer CyclopeMoveDataContainer;
+};
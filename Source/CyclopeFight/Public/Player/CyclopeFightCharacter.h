@@ -1,149 +1,214 @@
-// Copyright Epic Games, Inc. All Rights Reserved.
-
-#pragma once
-
-#include "CoreMinimal.h"
-#include "GameFramework/Character.h"
-#include "CyclopeFightCharacter.generated.h"
-
-class UCameraComponent;
-class USpringArmComponent;
-class UArrowComponent;
-class UNiagaraSystem;
-class UWidgetComponent;
-
-USTRUCT()
-struct FHitInfo
-{
-	GENERATED_BODY()
-
-	UPROPERTY()
-	FVector Origin;
-
-	UPROPERTY()
-	FVector ShootDir;
-};
-
-
-UCLASS(config=Game)
-class ACyclopeFightCharacter : public ACharacter
-{
-	GENERATED_BODY()	
-public:
-	ACyclopeFightCharacter();
-
-	virtual void BeginPlay() override;
-	
-	virtual float TakeDamage(float DamageAmount, FDamageEvent const& DamageEvent,
-						 AController* EventInstigator, AActor* DamageCauser) override final;
-
-	virtual void UnPossessed() override final;
-
-	virtual void GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeProps) const override final;
-
-	uint8 GetMaxHealth() const;
-
-	/** Returns CameraBoom subobject **/
-	FORCEINLINE USpringArmComponent* GetCameraBoom() const { return CameraBoom; }
-	/** Returns FollowCamera subobject **/
-	FORCEINLINE UCameraComponent* GetFollowCamera() const { return FollowCamera; }
-
-protected:
-	UFUNCTION(NetMulticast, Unreliable)
-	void Multicast_HideMesh();
-
-	/** Server notified of hit from client to verify **/
-	UFUNCTION(Server, Reliable)
-	void Server_NotifyHit(const FHitResult& Impact, FVector_NetQuantizeNormal ShootDir);
-
-	/** Server notified of miss to show trail FX **/
-	UFUNCTION(Server, Unreliable)
-	void Server_NotifyMiss(FVector_NetQuantizeNormal ShootDir);
-
-	/** Process hit and notify the server if necessary **/
-	void ProcessHit(const FHitResult& Impact, const FVector& Origin, const FVector& ShootDir);
-
-	/** Continue processing the hit, as if it has been confirmed by server **/
-	void ProcessHit_Confirmed(const FHitResult& Impact, const FVector& Origin, const FVector& ShootDir);
-
-	/** Handle damage **/
-	void DoDamage(AActor* DamagedActor);
-
-	FHitResult EyeTrace(const FVector& TraceStart, const FVector& TraceEnd) const;
-
-	/** Check if player should deal damage to actor **/
-	bool ShouldDealDamage(const AActor* TestActor) const;
-	
-	UFUNCTION()
-	void OnRep_Health();
-
-	/******* Effects replication START *******/
-	UFUNCTION()
-	void OnRep_HitNotify();
-
-	void SimulateHit(const FVector& Origin, const FVector& ShootDir) const;
-
-	/** Spawn laser effect **/
-	void SpawnLaserTrail(const FVector& EndTrace) const;
-	/******* Effects replication END *******/
-
-	/** Called for forwards/backward input */
-	void MoveForward(float Value);
-
-	/** Called for side to side input */
-	void MoveRight(float Value);
-
-	/** 
-	 * Called via input to turn at a given rate. 
-	 * @param Rate	This is a normalized rate, i.e. 1.0 means 100% of desired turn rate
-	 */
-	void TurnAtRate(float Rate);
-
-	void LookUp(float Rate);
-
-	void LookRight(float Rate);
-
-	/**
-	 * Called via input to shoot with a laser from the eye
-	 */
-	void Shoot();
-	
-	// APawn interface
-	virtual void SetupPlayerInputComponent(UInputComponent* PlayerInputComponent) override;
-	// End of APawn interface
-
-	/** Base turn rate, in deg/sec. Other scaling may affect final turn rate. */
-	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category=Camera)
-	float BaseTurnRate;
-
-	/** Base look up/down rate, in deg/sec. Other scaling may affect final rate. */
-	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category=Camera)
-	float BaseLookUpRate;
-
-	UPROPERTY(ReplicatedUsing=OnRep_Health)
-	float Health;
-
-	UPROPERTY(EditDefaultsOnly, Category=Health)
-	float MaxHealth;
-
-	UPROPERTY(Transient, ReplicatedUsing=OnRep_HitNotify)
-	FHitInfo HitNotify;
-
-	float LaserRange;
-
-private:
-	/** Camera boom positioning the camera behind the character */
-	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = Camera, meta = (AllowPrivateAccess = "true"))
-	USpringArmComponent* CameraBoom;
-
-	/** Follow camera */
-	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = Camera, meta = (AllowPrivateAccess = "true"))
-	UCameraComponent* FollowCamera;
-
-	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = Shooting, meta = (AllowPrivateAccess = "true"))
-	UArrowComponent* ShootDirectionArrow;
-
-	UPROPERTY(EditDefaultsOnly, BlueprintReadWrite, Category = Shooting, meta = (AllowPrivateAccess = "true"))
-	UNiagaraSystem* LaserBeamSystem;
-};
-
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "GameFramework/Character.h"
+#include "CyclopeFightCharacter.generated.h"
+
+class UCameraComponent;
+class USpringArmComponent;
+class UArrowComponent;
+class UNiagaraSystem;
+class UWidgetComponent;
+
+struct FNetOcclusionEntry
+{
+	float LastCheckTime{-BIG_NUMBER};
+	bool bOccluded{false};
+};
+
+
+UCLASS(config=Game)
+class ACyclopeFightCharacter : public ACharacter
+{
+	GENERATED_BODY()	
+public:
+	ACyclopeFightCharacter(const FObjectInitializer& ObjectInitializer);
+
+	virtual void BeginPlay() override;
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+	
+	virtual float TakeDamage(float DamageAmount, FDamageEvent const& DamageEvent,
+						 AController* EventInstigator, AActor* DamageCauser) override final;
+
+	virtual void UnPossessed() override final;
+
+	virtual void GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeProps) const override final;
+
+	virtual float GetNetPriority(const FVector& ViewPos, const FVector& ViewDir, AActor* Viewer, AActor* ViewTarget,
+		UActorChannel* InChannel, float Time, bool bLowBandwidth) override;
+
+	/** Not relevant to connections that have not loaded the arena cell we are in **/
+	virtual bool IsNetRelevantFor(const AActor* RealViewer, const AActor* ViewTarget,
+		const FVector& SrcLocation) const override;
+
+	uint8 GetMaxHealth() const;
+
+	/**
+	 * Called via input to shoot with a laser from the eye
+	 */
+	void Shoot();
+
+	/**
+	 * On a dedicated server the mesh pose is not evaluated. Features that need bone
+	 * transforms there must hold a request for as long as they read them.
+	 */
+	void AcquireServerPose();
+	void ReleaseServerPose();
+
+	/** Play a shot fired by this character on a remote client **/
+	void SimulateHit(const FVector& Origin, const FVector& ShootDir) const;
+
+	/** Assets only a client needs, preloaded together with the character class **/
+	void GetClientAssets(TArray<FSoftObjectPath>& OutAssets) const;
+
+	/** Turn the character and its eye towards Target, used by scripted firing **/
+	void AimAt(const FVector& Target);
+
+	/** Returns CameraBoom subobject **/
+	FORCEINLINE USpringArmComponent* GetCameraBoom() const { return CameraBoom; }
+	/** Returns FollowCamera subobject **/
+	FORCEINLINE UCameraComponent* GetFollowCamera() const { return FollowCamera; }
+
+protected:
+	UFUNCTION(NetMulticast, Unreliable)
+	void Multicast_HideMesh();
+
+	/**
+	 * Server notified of hit from client to verify. TargetTimestamp is the movement
+	 * timestamp of the hit character the shooter was rendering, 0 if unknown
+	 **/
+	UFUNCTION(Server, Reliable)
+	void Server_NotifyHit(const FHitResult& Impact, FVector_NetQuantizeNormal ShootDir, float TargetTimestamp);
+
+	/** Server notified of miss to show trail FX **/
+	UFUNCTION(Server, Unreliable)
+	void Server_NotifyMiss(FVector_NetQuantizeNormal ShootDir);
+
+	/** Process hit and notify the server if necessary **/
+	void ProcessHit(const FHitResult& Impact, const FVector& Origin, const FVector& ShootDir);
+
+	/** Continue processing the hit, as if it has been confirmed by server **/
+	void ProcessHit_Confirmed(const FHitResult& Impact, const FVector& Origin, const FVector& ShootDir);
+
+	/** Handle damage **/
+	void DoDamage(AActor* DamagedActor);
+
+	FHitResult EyeTrace(const FVector& TraceStart, const FVector& TraceEnd) const;
+
+	/** Check if player should deal damage to actor **/
+	bool ShouldDealDamage(const AActor* TestActor) const;
+	
+	UFUNCTION()
+	void OnRep_Health();
+
+	/** Raise replication rate to every viewer for a short while **/
+	void MarkCombatActivity();
+
+	/** Stop evaluating the mesh pose, dedicated server only **/
+	void ApplyServerAnimPolicy();
+
+	/** Cached line of sight test between a viewer and this character **/
+	bool IsOccludedFrom(AActor* Viewer, AActor* ViewTarget, const FVector& ViewPos) const;
+
+	/******* Effects replication START *******/
+	/** Hand the shot to the server's shot interest management **/
+	void NotifyShotFired(const FVector& Origin, const FVector& ShootDir);
+
+	/** Request laser effect from the FX significance budget **/
+	void SpawnLaserTrail(const FVector& EndTrace) const;
+	/******* Effects replication END *******/
+
+	/** Called for forwards/backward input */
+	void MoveForward(float Value);
+
+	/** Called for side to side input */
+	void MoveRight(float Value);
+
+	/** 
+	 * Called via input to turn at a given rate. 
+	 * @param Rate	This is a normalized rate, i.e. 1.0 means 100% of desired turn rate
+	 */
+	void TurnAtRate(float Rate);
+
+	void LookUp(float Rate);
+
+	void LookRight(float Rate);
+
+	// APawn interface
+	virtual void SetupPlayerInputComponent(UInputComponent* PlayerInputComponent) override;
+	// End of APawn interface
+
+	/** Base turn rate, in deg/sec. Other scaling may affect final turn rate. */
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category=Camera)
+	float BaseTurnRate;
+
+	/** Base look up/down rate, in deg/sec. Other scaling may affect final rate. */
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category=Camera)
+	float BaseLookUpRate;
+
+	UPROPERTY(ReplicatedUsing=OnRep_Health)
+	float Health;
+
+	UPROPERTY(EditDefaultsOnly, Category=Health)
+	float MaxHealth;
+
+	float LaserRange;
+
+	/******* Per connection replication priority START *******/
+	/** Viewers aiming within this angle of the character get full rate updates **/
+	UPROPERTY(Config, EditDefaultsOnly, Category=Replication)
+	float NetAimConeHalfAngle;
+
+	/** Viewers closer than this get full rate updates whatever they aim at **/
+	UPROPERTY(Config, EditDefaultsOnly, Category=Replication)
+	float NetNearDistance;
+
+	/** Beyond this distance the aim cone no longer grants full rate **/
+	UPROPERTY(Config, EditDefaultsOnly, Category=Replication)
+	float NetFarDistance;
+
+	/** Priority multiplier for distant, occluded or out of aim viewers **/
+	UPROPERTY(Config, EditDefaultsOnly, Category=Replication)
+	float NetReducedPriorityScale;
+
+	/** Priority multiplier while firing or taking damage **/
+	UPROPERTY(Config, EditDefaultsOnly, Category=Replication)
+	float NetCombatPriorityScale;
+
+	UPROPERTY(Config, EditDefaultsOnly, Category=Replication)
+	float NetCombatBoostTime;
+
+	UPROPERTY(Config, EditDefaultsOnly, Category=Replication)
+	float NetOcclusionCheckInterval;
+
+	float LastCombatTime;
+
+	mutable TMap<TWeakObjectPtr<AActor>, FNetOcclusionEntry> NetOcclusionCache;
+	/******* Per connection replication priority END *******/
+
+	bool bServerAnimPolicy;
+	int32 ServerPoseRequests;
+
+private:
+	/** Camera boom positioning the camera behind the character */
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = Camera, meta = (AllowPrivateAccess = "true"))
+	USpringArmComponent* CameraBoom;
+
+	/** Follow camera */
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = Camera, meta = (AllowPrivateAccess = "true"))
+	UCameraComponent* FollowCamera;
+
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = Shooting, meta = (AllowPrivateAccess = "true"))
+	UArrowComponent* ShootDirectionArrow;
+
+	/** Soft so the character class loads without FX on a dedicated server **/
+	UPROPERTY(EditDefaultsOnly, BlueprintReadWrite, Category = Shooting, meta = (AllowPrivateAccess = "true"))
+	TSoftObjectPtr<UNiagaraSystem> LaserBeamSystem;
+
+	/** Cheaper beam used for low significance shots. If not set, those shots are not drawn **/
+	UPROPERTY(EditDefaultsOnly, BlueprintReadWrite, Category = Shooting, meta = (AllowPrivateAccess = "true"))
+	TSoftObjectPtr<UNiagaraSystem> LowLaserBeamSystem;
+};
+
@@ -1,20 +1,49 @@
-// Fill out your copyright notice in the Description page of Project Settings.
-
-#pragma once
-
-#include "CoreMinimal.h"
-#include "GameFramework/HUD.h"
-#include "CyclopeHUD.generated.h"
-
-/**
- * 
- */
-UCLASS()
-class CYCLOPEFIGHT_API ACyclopeHUD : public AHUD
-{
-	GENERATED_BODY()
-
-public:
-	UFUNCTION(BlueprintImplementableEvent)
-	void UpdateHealthBar(float HealthAlpha);
-};
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "GameFramework/HUD.h"
+#include "CyclopeHUD.generated.h"
+
+class AGameStateBase;
+class UCyclopeHUDWidget;
+
+/**
+ * Owns the native HUD widget and feeds it health and score changes
+ */
+UCLASS()
+class CYCLOPEFIGHT_API ACyclopeHUD : public AHUD
+{
+	GENERATED_BODY()
+
+public:
+	ACyclopeHUD();
+
+	virtual void BeginPlay() override;
+
+	void SetHealthAlpha(float HealthAlpha);
+
+	void UpdateScore(int32 Player1Score, int32 Player2Score);
+
+protected:
+	/**
+	 * Legacy Blueprint health hook, only reached when CyclopeAssetPreloadSubsystem's HUDClass
+	 * opts back into CyclopeHUD_BP. A Blueprint subclass implementing it draws its own health
+	 * widget and gets health here, and the native widget is not created.
+	 */
+	UFUNCTION(BlueprintImplementableEvent, meta=(DeprecatedFunction,
+		DeprecationMessage="UCyclopeHUDWidget shows health now, remove this event and the PlayerHUDWidget it creates"))
+	void UpdateHealthBar(float HealthAlpha);
+
+	UPROPERTY(EditDefaultsOnly, Category=HUD)
+	TSubclassOf<UCyclopeHUDWidget> HUDWidgetClass;
+
+private:
+	bool HasLegacyBlueprintHUD() const;
+
+	void OnGameStateSet(AGameStateBase* GameState);
+
+	UPROPERTY(Transient)
+	UCyclopeHUDWidget* HUDWidget;
+};
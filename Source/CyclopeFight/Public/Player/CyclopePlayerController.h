@@ -1,56 +1,93 @@
-// Fill out your copyright notice in the Description page of Project Settings.
-
-#pragma once
-
-#include "CoreMinimal.h"
-#include "GameFramework/PlayerController.h"
-#include "CyclopePlayerController.generated.h"
-
-class ACyclopeFightCharacter;
-
-DECLARE_DYNAMIC_MULTICAST_DELEGATE(FPawnPossessed);
-DECLARE_DYNAMIC_MULTICAST_DELEGATE(FPawnUnPossessed);
-
-/**
- * 
- */
-UCLASS()
-class CYCLOPEFIGHT_API ACyclopePlayerController : public APlayerController
-{
-	GENERATED_BODY()
-
-public:
-	ACyclopePlayerController();
-	
-	virtual void BeginPlay() override;
-	virtual void OnPossess(APawn* InPawn) override;
-	virtual void OnUnPossess() override;
-	virtual void SetupInputComponent() override;
-
-	void TryToRespawn();
-
-	UFUNCTION(BlueprintCallable)
-	float GetMaxHealth() const;
-
-	void SetPlayerID(int32 ID);
-
-	UFUNCTION(BlueprintPure)
-	int32 GetPlayerID() const;
-
-	void HealthChangedNotify(float HealthAlpha) const;
-	
-	void KilledByEnemy() const;
-
-	UFUNCTION(Server, Reliable)
-	void RequestGMRespawn();
-
-	UPROPERTY(BlueprintAssignable)
-	FPawnPossessed OnPawnPossessed;
-	
-	UPROPERTY(BlueprintAssignable)
-	FPawnUnPossessed OnPawnUnPossessed;
-
-private:
-	UPROPERTY(Replicated)
-	int32 UniquePlayerID;
-};
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "GameFramework/PlayerController.h"
+#include "Game/CyclopeShotEventSubsystem.h"
+#include "CyclopePlayerController.generated.h"
+
+class ACyclopeFightCharacter;
+class INetworkReplayStreamer;
+struct FEnumerateStreamsResult;
+
+DECLARE_DYNAMIC_MULTICAST_DELEGATE(FPawnPossessed);
+DECLARE_DYNAMIC_MULTICAST_DELEGATE(FPawnUnPossessed);
+
+/**
+ * 
+ */
+UCLASS()
+class CYCLOPEFIGHT_API ACyclopePlayerController : public APlayerController
+{
+	GENERATED_BODY()
+
+public:
+	ACyclopePlayerController();
+	
+	virtual void BeginPlay() override;
+	virtual void OnPossess(APawn* InPawn) override;
+	virtual void OnUnPossess() override;
+	virtual void SetupInputComponent() override;
+
+	/** Replaces the native HUD class sent by the server with the preloaded Blueprint **/
+	virtual void ClientSetHUD_Implementation(TSubclassOf<AHUD> NewHUDClass) override;
+
+	void TryToRespawn();
+
+	/** Spectator spawned by the demo net driver to record the match on the server **/
+	bool IsReplayRecorder() const;
+
+	/**
+	 * Play the most recent recording of the replay server under its own session name,
+	 * so the stream does not switch to the next match while watching
+	 */
+	UFUNCTION(Exec)
+	void WatchLatestReplay();
+
+	UFUNCTION(BlueprintCallable)
+	float GetMaxHealth() const;
+
+	void SetPlayerID(int32 ID);
+
+	UFUNCTION(BlueprintPure)
+	int32 GetPlayerID() const;
+
+	void HealthChangedNotify(float HealthAlpha) const;
+	
+	void KilledByEnemy() const;
+
+	UFUNCTION(Server, Reliable)
+	void RequestGMRespawn();
+
+	/** Laser shots the server decided this client may see **/
+	UFUNCTION(Client, Unreliable)
+	void Client_ReceiveLaserShots(const TArray<FLaserShotEvent>& Shots);
+
+	/** Network benchmark: a hit to judge, sent next to the gameplay Server_NotifyHit **/
+	UFUNCTION(Server, Reliable)
+	void Server_BenchHitClaimed(uint16 ClaimId, const FHitResult& Impact, float TargetTimestamp);
+
+	/** Network benchmark: the server answered the hit claim ClaimId **/
+	UFUNCTION(Client, Reliable)
+	void Client_BenchHitConfirmed(uint16 ClaimId, bool bServerAgreed);
+
+	/** Network benchmark: the server switched to another profile **/
+	UFUNCTION(Client, Reliable)
+	void Client_BenchProfileChanged(uint8 ProfileIdx);
+
+	UPROPERTY(BlueprintAssignable)
+	FPawnPossessed OnPawnPossessed;
+	
+	UPROPERTY(BlueprintAssignable)
+	FPawnUnPossessed OnPawnUnPossessed;
+
+private:
+	void OnReplaysEnumerated(const FEnumerateStreamsResult& Result);
+
+	UPROPERTY(Replicated)
+	int32 UniquePlayerID;
+
+	/** Kept alive until the replay list arrives **/
+	TSharedPtr<INetworkReplayStreamer> ReplayEnumerator;
+};
@@ -0,0 +1,54 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Blueprint/UserWidget.h"
+#include "CyclopeHUDWidget.generated.h"
+
+class UProgressBar;
+class UTextBlock;
+
+/**
+ * Native health and score HUD. The widget tree sits under an invalidation box,
+ * so it is only repainted when a value actually changes. Changes arriving in
+ * the same frame are applied together on the next tick.
+ */
+UCLASS()
+class CYCLOPEFIGHT_API UCyclopeHUDWidget : public UUserWidget
+{
+	GENERATED_BODY()
+
+public:
+	UCyclopeHUDWidget(const FObjectInitializer& ObjectInitializer);
+
+	void SetHealthAlpha(float HealthAlpha);
+
+	void SetScore(int32 Player1Score, int32 Player2Score);
+
+protected:
+	/** Builds the default layout unless a Blueprint subclass provides its own **/
+	virtual TSharedRef<SWidget> RebuildWidget() override;
+
+	UPROPERTY(BlueprintReadOnly, Category=HUD, meta=(BindWidgetOptional))
+	UProgressBar* HealthBar;
+
+	UPROPERTY(BlueprintReadOnly, Category=HUD, meta=(BindWidgetOptional))
+	UTextBlock* ScoreText;
+
+private:
+	void ScheduleFlush();
+
+	/** Push pending values into the widgets **/
+	void Flush();
+
+	float PendingHealthAlpha;
+	int32 PendingPlayer1Score;
+	int32 PendingPlayer2Score;
+
+	float ShownHealthAlpha;
+	int32 ShownPlayer1Score;
+	int32 ShownPlayer2Score;
+
+	bool bFlushScheduled;
+};
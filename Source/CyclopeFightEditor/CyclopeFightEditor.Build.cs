@@ -0,0 +1,16 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+using UnrealBuildTool;
+
+public class CyclopeFightEditor : ModuleRules
+{
+	public CyclopeFightEditor(ReadOnlyTargetRules Target) : base(Target)
+	{
+		PCHUsage = PCHUsageMode.UseExplicitOrSharedPCHs;
+
+		PublicDependencyModuleNames.AddRange(new string[] { "Core", "CoreUObject", "Engine", "CyclopeFight" });
+
+		// Replay relay commandlet
+		PrivateDependencyModuleNames.AddRange(new string[] { "HTTPServer", "Json" });
+	}
+}
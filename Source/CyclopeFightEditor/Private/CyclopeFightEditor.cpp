@@ -0,0 +1,6 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+#include "Modules/ModuleManager.h"
+
+/** Editor and commandlet only code, never part of a game client or server build **/
+IMPLEMENT_MODULE(FDefaultModuleImpl, CyclopeFightEditor);
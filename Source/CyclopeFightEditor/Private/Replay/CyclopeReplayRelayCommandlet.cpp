@@ -0,0 +1,481 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "Replay/CyclopeReplayRelayCommandlet.h"
+
+#include "CyclopeFight.h"
+#include "Containers/Ticker.h"
+#include "Dom/JsonObject.h"
+#include "GenericPlatform/GenericPlatformHttp.h"
+#include "HttpPath.h"
+#include "HttpServerModule.h"
+#include "HttpServerRequest.h"
+#include "HttpServerResponse.h"
+#include "IHttpRouter.h"
+#include "Serialization/JsonSerializer.h"
+
+namespace
+{
+	/** Between the session name and the event name in event ids, no event name or group contains it **/
+	const TCHAR* EventIdSeparator = TEXT("~");
+
+	TUniquePtr<FHttpServerResponse> MakeJsonResponse(const TSharedRef<FJsonObject>& Json)
+	{
+		FString Body;
+		const auto Writer = TJsonWriterFactory<TCHAR, TCondensedJsonPrintPolicy<TCHAR>>::Create(&Body);
+		FJsonSerializer::Serialize(Json, Writer);
+		return FHttpServerResponse::Create(Body, TEXT("application/json"));
+	}
+
+	TUniquePtr<FHttpServerResponse> MakeNotFound()
+	{
+		return FHttpServerResponse::Error(EHttpServerResponseCodes::NotFound);
+	}
+
+	int32 QueryInt(const FHttpServerRequest& Request, const TCHAR* Key, int32 Default = 0)
+	{
+		const auto Value = Request.QueryParams.Find(Key);
+		return Value ? FCString::Atoi(**Value) : Default;
+	}
+
+	FString QueryString(const FHttpServerRequest& Request, const TCHAR* Key)
+	{
+		const auto Value = Request.QueryParams.Find(Key);
+		return Value ? FGenericPlatformHttp::UrlDecode(*Value) : FString();
+	}
+
+	void SplitPath(const FHttpServerRequest& Request, TArray<FString>& OutSegments)
+	{
+		Request.RelativePath.GetPath().ParseIntoArray(OutSegments, TEXT("/"), true);
+	}
+}
+
+UCyclopeReplayRelayCommandlet::UCyclopeReplayRelayCommandlet()
+{
+	IsClient = false;
+	IsServer = false;
+	IsEditor = false;
+	LogToConsole = true;
+	ShowErrorCount = false;
+
+	ViewerTimeout = 60.0;
+	SessionExpiry = 30.0 * 60.0;
+	NextSessionId = 0;
+	NextViewerId = 0;
+}
+
+int32 UCyclopeReplayRelayCommandlet::Main(const FString& Params)
+{
+	int32 Port = 8088;
+	float ReportInterval = 10.f;
+	float SessionExpiryMinutes = SessionExpiry / 60.0;
+	FParse::Value(*Params, TEXT("Port="), Port);
+	FParse::Value(*Params, TEXT("ReportInterval="), ReportInterval);
+	FParse::Value(*Params, TEXT("SessionExpiryMinutes="), SessionExpiryMinutes);
+	SessionExpiry = SessionExpiryMinutes * 60.0;
+
+	auto& HttpServer = FHttpServerModule::Get();
+	const auto Router = HttpServer.GetHttpRouter(Port);
+	if (!Router.IsValid())
+	{
+		UE_LOG(LogCyclope, Error, TEXT("Replay relay: could not listen on port %d"), Port);
+		return 1;
+	}
+
+	const auto Verbs = EHttpServerRequestVerbs::VERB_GET | EHttpServerRequestVerbs::VERB_POST;
+	const auto ReplayRoute = Router->BindRoute(FHttpPath(TEXT("/replay")), Verbs,
+		[this](const FHttpServerRequest& Request, const FHttpResultCallback& OnComplete)
+		{
+			return HandleReplay(Request, OnComplete);
+		});
+	const auto EventRoute = Router->BindRoute(FHttpPath(TEXT("/event")), Verbs,
+		[this](const FHttpServerRequest& Request, const FHttpResultCallback& OnComplete)
+		{
+			return HandleEvent(Request, OnComplete);
+		});
+
+	HttpServer.StartAllListeners();
+	UE_LOG(LogCyclope, Display, TEXT("Replay relay listening on port %d"), Port);
+
+	double LastTime = FPlatformTime::Seconds();
+	double LastReport = LastTime;
+	while (!IsEngineExitRequested())
+	{
+		const double Now = FPlatformTime::Seconds();
+		FTicker::GetCoreTicker().Tick(Now - LastTime);
+		LastTime = Now;
+
+		if (Now - LastReport >= ReportInterval)
+		{
+			ReportStats(Now - LastReport);
+			ExpireSessions();
+			LastReport = Now;
+		}
+
+		FPlatformProcess::Sleep(0.002f);
+	}
+
+	Router->UnbindRoute(ReplayRoute);
+	Router->UnbindRoute(EventRoute);
+	HttpServer.StopAllListeners();
+
+	return 0;
+}
+
+TSharedPtr<FCyclopeRelaySession> UCyclopeReplayRelayCommandlet::FindSession(const FString& Name) const
+{
+	const auto Session = Sessions.Find(Name);
+	return Session ? *Session : nullptr;
+}
+
+bool UCyclopeReplayRelayCommandlet::HandleReplay(const FHttpServerRequest& Request,
+	const FHttpResultCallback& OnComplete)
+{
+	TArray<FString> Segments;
+	SplitPath(Request, Segments);
+
+	const bool bPost = Request.Verb == EHttpServerRequestVerbs::VERB_POST;
+
+	// /replay
+	if (Segments.Num() == 0)
+	{
+		if (bPost)
+		{
+			HandleStartUploading(FString(), Request, OnComplete);
+		}
+		else
+		{
+			HandleList(Request, OnComplete);
+		}
+		return true;
+	}
+
+	// /replay/<session>
+	if (Segments.Num() == 1 && bPost)
+	{
+		HandleStartUploading(Segments[0], Request, OnComplete);
+		return true;
+	}
+
+	const auto Session = FindSession(Segments[0]);
+	if (!Session.IsValid() || Segments.Num() < 2)
+	{
+		OnComplete(MakeNotFound());
+		return true;
+	}
+
+	const FString& Action = Segments[1];
+	if (Action == TEXT("file") && Segments.Num() == 3)
+	{
+		HandleFile(*Session, Segments[2], Request, OnComplete);
+	}
+	else if (Action == TEXT("event"))
+	{
+		HandleSessionEvents(*Session, Segments.IsValidIndex(2) ? Segments[2] : FString(), Request, OnComplete);
+	}
+	else if (Action == TEXT("startDownloading"))
+	{
+		const FString ViewerId = FString::Printf(TEXT("viewer%d"), NextViewerId++);
+		Session->Viewers.Add(ViewerId, FPlatformTime::Seconds());
+
+		auto Json = MakeShared<FJsonObject>();
+		Json->SetStringField(TEXT("state"), Session->bLive ? TEXT("Live") : TEXT("Final"));
+		Json->SetNumberField(TEXT("numChunks"), Session->Chunks.Num());
+		Json->SetNumberField(TEXT("time"), Session->DemoTimeMs);
+		Json->SetStringField(TEXT("viewerId"), ViewerId);
+		OnComplete(MakeJsonResponse(Json));
+	}
+	else if (Action == TEXT("viewer") && Segments.Num() == 3)
+	{
+		if (QueryString(Request, TEXT("final")) == TEXT("true"))
+		{
+			Session->Viewers.Remove(Segments[2]);
+		}
+		else
+		{
+			Session->Viewers.Add(Segments[2], FPlatformTime::Seconds());
+		}
+		OnComplete(FHttpServerResponse::Ok());
+	}
+	else if (Action == TEXT("stopUploading"))
+	{
+		Session->bLive = false;
+		Session->LastUploadTime = FPlatformTime::Seconds();
+		Session->DemoTimeMs = QueryInt(Request, TEXT("time"), Session->DemoTimeMs);
+		UE_LOG(LogCyclope, Display, TEXT("Replay relay: %s finished, %d chunks, %.1f MiB received"), *Session->Name,
+			Session->Chunks.Num(), Session->BytesIn / 1048576.0);
+		OnComplete(FHttpServerResponse::Ok());
+	}
+	else
+	{
+		// Keep alive and metadata requests carry nothing the relay needs
+		OnComplete(bPost ? FHttpServerResponse::Ok() : MakeNotFound());
+	}
+
+	return true;
+}
+
+bool UCyclopeReplayRelayCommandlet::HandleEvent(const FHttpServerRequest& Request,
+	const FHttpResultCallback& OnComplete)
+{
+	TArray<FString> Segments;
+	SplitPath(Request, Segments);
+
+	// /event/<session>~<event>, session names may contain anything but event names do not
+	if (Segments.Num() == 1)
+	{
+		FString SessionName, Rest;
+		if (Segments[0].Split(EventIdSeparator, &SessionName, &Rest, ESearchCase::CaseSensitive, ESearchDir::FromEnd))
+		{
+			if (const auto Session = FindSession(SessionName))
+			{
+				for (const auto& Event : Session->Events)
+				{
+					if (Event.Id == Segments[0])
+					{
+						Session->BytesOut += Event.Data.Num();
+						auto Data = Event.Data;
+						OnComplete(FHttpServerResponse::Create(MoveTemp(Data), TEXT("application/octet-stream")));
+						return true;
+					}
+				}
+			}
+		}
+	}
+
+	OnComplete(MakeNotFound());
+	return true;
+}
+
+void UCyclopeReplayRelayCommandlet::HandleList(const FHttpServerRequest& Request,
+	const FHttpResultCallback& OnComplete)
+{
+	const FString App = QueryString(Request, TEXT("app"));
+
+	TArray<TSharedPtr<FJsonValue>> Replays;
+	for (const auto& Pair : Sessions)
+	{
+		const auto& Session = *Pair.Value;
+		if (!App.IsEmpty() && Session.App != App)
+		{
+			continue;
+		}
+
+		int64 Size = Session.Header.Num();
+		for (const auto& Chunk : Session.Chunks)
+		{
+			Size += Chunk.Data.Num();
+		}
+
+		auto Json = MakeShared<FJsonObject>();
+		Json->SetStringField(TEXT("app"), Session.App);
+		Json->SetStringField(TEXT("sessionName"), Session.Name);
+		Json->SetStringField(TEXT("friendlyName"), Session.FriendlyName);
+		Json->SetStringField(TEXT("timestamp"), Session.Created.ToIso8601());
+		Json->SetNumberField(TEXT("sizeInBytes"), Size);
+		Json->SetNumberField(TEXT("demoTimeInMs"), Session.DemoTimeMs);
+		Json->SetNumberField(TEXT("numViewers"), Session.Viewers.Num());
+		Json->SetBoolField(TEXT("bIsLive"), Session.bLive);
+		Json->SetNumberField(TEXT("changelist"), Session.Changelist);
+		Json->SetBoolField(TEXT("shouldKeep"), false);
+		Replays.Add(MakeShared<FJsonValueObject>(Json));
+	}
+
+	auto Json = MakeShared<FJsonObject>();
+	Json->SetArrayField(TEXT("replays"), Replays);
+	OnComplete(MakeJsonResponse(Json));
+}
+
+void UCyclopeReplayRelayCommandlet::HandleStartUploading(const FString& SessionName,
+	const FHttpServerRequest& Request, const FHttpResultCallback& OnComplete)
+{
+	auto Session = MakeShared<FCyclopeRelaySession>();
+	Session->Name = SessionName.IsEmpty() ? FString::Printf(TEXT("match%d"), NextSessionId++) : SessionName;
+	Session->FriendlyName = QueryString(Request, TEXT("friendlyName"));
+	Session->App = QueryString(Request, TEXT("app"));
+	Session->Version = QueryInt(Request, TEXT("version"));
+	Session->Changelist = QueryInt(Request, TEXT("cl"));
+	Session->Created = FDateTime::UtcNow();
+	Session->LastUploadTime = FPlatformTime::Seconds();
+
+	Sessions.Add(Session->Name, Session);
+
+	UE_LOG(LogCyclope, Display, TEXT("Replay relay: recording %s (%s)"), *Session->Name, *Session->FriendlyName);
+
+	auto Json = MakeShared<FJsonObject>();
+	Json->SetStringField(TEXT("sessionId"), Session->Name);
+	OnComplete(MakeJsonResponse(Json));
+}
+
+void UCyclopeReplayRelayCommandlet::HandleFile(FCyclopeRelaySession& Session, const FString& FileName,
+	const FHttpServerRequest& Request, const FHttpResultCallback& OnComplete)
+{
+	const bool bPost = Request.Verb == EHttpServerRequestVerbs::VERB_POST;
+
+	if (FileName == TEXT("replay.header"))
+	{
+		if (bPost)
+		{
+			Session.Header = Request.Body;
+			Session.BytesIn += Request.Body.Num();
+			Session.LastUploadTime = FPlatformTime::Seconds();
+			OnComplete(FHttpServerResponse::Ok());
+		}
+		else
+		{
+			Session.BytesOut += Session.Header.Num();
+			auto Data = Session.Header;
+			OnComplete(FHttpServerResponse::Create(MoveTemp(Data), TEXT("application/octet-stream")));
+		}
+		return;
+	}
+
+	FString ChunkIndexString;
+	if (!FileName.Split(TEXT("stream."), nullptr, &ChunkIndexString))
+	{
+		OnComplete(MakeNotFound());
+		return;
+	}
+	const int32 ChunkIndex = FCString::Atoi(*ChunkIndexString);
+
+	if (bPost)
+	{
+		if (ChunkIndex >= Session.Chunks.Num())
+		{
+			Session.Chunks.SetNum(ChunkIndex + 1);
+		}
+
+		auto& Chunk = Session.Chunks[ChunkIndex];
+		Chunk.Data = Request.Body;
+		Chunk.MTime1 = QueryInt(Request, TEXT("mTime1"));
+		Chunk.MTime2 = QueryInt(Request, TEXT("mTime2"));
+		Session.DemoTimeMs = QueryInt(Request, TEXT("time"), Session.DemoTimeMs);
+		Session.BytesIn += Request.Body.Num();
+		Session.LastUploadTime = FPlatformTime::Seconds();
+
+		OnComplete(FHttpServerResponse::Ok());
+		return;
+	}
+
+	if (!Session.Chunks.IsValidIndex(ChunkIndex))
+	{
+		// A live spectator caught up with the recording, it retries after its poll delay
+		OnComplete(MakeNotFound());
+		return;
+	}
+
+	const auto& Chunk = Session.Chunks[ChunkIndex];
+	Session.BytesOut += Chunk.Data.Num();
+
+	auto Data = Chunk.Data;
+	auto Response = FHttpServerResponse::Create(MoveTemp(Data), TEXT("application/octet-stream"));
+	Response->Headers.Add(TEXT("NumChunks"), {FString::FromInt(Session.Chunks.Num())});
+	Response->Headers.Add(TEXT("Time"), {FString::FromInt(Session.DemoTimeMs)});
+	Response->Headers.Add(TEXT("State"), {Session.bLive ? TEXT("Live") : TEXT("Final")});
+	Response->Headers.Add(TEXT("MTime1"), {FString::FromInt(Chunk.MTime1)});
+	Response->Headers.Add(TEXT("MTime2"), {FString::FromInt(Chunk.MTime2)});
+	OnComplete(MoveTemp(Response));
+}
+
+void UCyclopeReplayRelayCommandlet::HandleSessionEvents(FCyclopeRelaySession& Session, const FString& EventName,
+	const FHttpServerRequest& Request, const FHttpResultCallback& OnComplete)
+{
+	const FString Group = QueryString(Request, TEXT("group"));
+
+	if (Request.Verb == EHttpServerRequestVerbs::VERB_POST)
+	{
+		// Named events are updated in place, checkpoints get a new id each time
+		const FString Id = Session.Name + EventIdSeparator +
+			(EventName.IsEmpty() ? FString::Printf(TEXT("%s%d"), *Group, Session.Events.Num()) : EventName);
+
+		auto Event = Session.Events.FindByPredicate([&Id](const FCyclopeRelayEvent& Other)
+		{
+			return Other.Id == Id;
+		});
+		if (!Event)
+		{
+			Event = &Session.Events.AddDefaulted_GetRef();
+			Event->Id = Id;
+		}
+
+		Event->Group = Group;
+		Event->Meta = QueryString(Request, TEXT("meta"));
+		Event->Time1 = QueryInt(Request, TEXT("time1"));
+		Event->Time2 = QueryInt(Request, TEXT("time2"));
+		Event->Data = Request.Body;
+		Session.BytesIn += Request.Body.Num();
+		Session.LastUploadTime = FPlatformTime::Seconds();
+
+		OnComplete(FHttpServerResponse::Ok());
+		return;
+	}
+
+	TArray<TSharedPtr<FJsonValue>> Events;
+	for (const auto& Event : Session.Events)
+	{
+		if (!Group.IsEmpty() && Event.Group != Group)
+		{
+			continue;
+		}
+
+		auto Json = MakeShared<FJsonObject>();
+		Json->SetStringField(TEXT("id"), Event.Id);
+		Json->SetStringField(TEXT("group"), Event.Group);
+		Json->SetStringField(TEXT("meta"), Event.Meta);
+		Json->SetNumberField(TEXT("time1"), Event.Time1);
+		Json->SetNumberField(TEXT("time2"), Event.Time2);
+		Events.Add(MakeShared<FJsonValueObject>(Json));
+	}
+
+	auto Json = MakeShared<FJsonObject>();
+	Json->SetArrayField(TEXT("events"), Events);
+	OnComplete(MakeJsonResponse(Json));
+}
+
+void UCyclopeReplayRelayCommandlet::ReportStats(double Interval)
+{
+	const double Now = FPlatformTime::Seconds();
+
+	for (auto& Pair : Sessions)
+	{
+		auto& Session = *Pair.Value;
+		for (auto It = Session.Viewers.CreateIterator(); It; ++It)
+		{
+			if (Now - It.Value() > ViewerTimeout)
+			{
+				It.RemoveCurrent();
+			}
+		}
+
+		if (!Session.bLive && Session.BytesOut == Session.ReportedBytesOut)
+		{
+			continue;
+		}
+
+		UE_LOG(LogCyclope, Display, TEXT("Replay relay [%s] in %.1f KiB/s, out %.1f KiB/s to %d viewers"),
+			*Session.Name, (Session.BytesIn - Session.ReportedBytesIn) / 1024.0 / Interval,
+			(Session.BytesOut - Session.ReportedBytesOut) / 1024.0 / Interval, Session.Viewers.Num());
+
+		Session.ReportedBytesIn = Session.BytesIn;
+		Session.ReportedBytesOut = Session.BytesOut;
+	}
+}
+
+void UCyclopeReplayRelayCommandlet::ExpireSessions()
+{
+	// A live session uploads every couple of seconds, so this also catches servers that died mid match
+	const double Now = FPlatformTime::Seconds();
+	for (auto It = Sessions.CreateIterator(); It; ++It)
+	{
+		const auto& Session = *It.Value();
+		if (Now - Session.LastUploadTime < SessionExpiry || Session.Viewers.Num() > 0)
+		{
+			continue;
+		}
+
+		UE_LOG(LogCyclope, Display, TEXT("Replay relay: %s expired, %.1f MiB released"), *Session.Name,
+			Session.BytesIn / 1048576.0);
+
+		It.RemoveCurrent();
+	}
+}
@@ -0,0 +1,108 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Commandlets/Commandlet.h"
+#include "HttpRouteHandle.h"
+#include "HttpResultCallback.h"
+#include "CyclopeReplayRelayCommandlet.generated.h"
+
+struct FHttpServerRequest;
+
+/** One flushed piece of the replay stream **/
+struct FCyclopeRelayChunk
+{
+	TArray<uint8> Data;
+	uint32 MTime1{0};
+	uint32 MTime2{0};
+};
+
+/** Checkpoint or game event attached to a replay **/
+struct FCyclopeRelayEvent
+{
+	FString Id;
+	FString Group;
+	FString Meta;
+	uint32 Time1{0};
+	uint32 Time2{0};
+	TArray<uint8> Data;
+};
+
+/** A replay uploaded by a match server, kept in memory for spectators **/
+struct FCyclopeRelaySession
+{
+	FString Name;
+	FString FriendlyName;
+	FString App;
+	int32 Version{0};
+	int32 Changelist{0};
+	FDateTime Created;
+
+	TArray<uint8> Header;
+	TArray<FCyclopeRelayChunk> Chunks;
+	TArray<FCyclopeRelayEvent> Events;
+
+	uint32 DemoTimeMs{0};
+	bool bLive{true};
+
+	/** Last upload from the match server, finished or abandoned sessions expire from here **/
+	double LastUploadTime{0.0};
+
+	/** Last refresh time of each spectator **/
+	TMap<FString, double> Viewers;
+
+	uint64 BytesIn{0};
+	uint64 BytesOut{0};
+	uint64 ReportedBytesIn{0};
+	uint64 ReportedBytesOut{0};
+};
+
+/**
+ * Local replay relay, run as a separate process:
+ *   UE4Editor-Cmd CyclopeFight.uproject -run=CyclopeReplayRelay -Port=8088
+ * It speaks the HttpNetworkReplayStreaming protocol. A match server uploads its
+ * replay once while recording, any number of spectators download it live from here.
+ * Editor module only, neither game clients nor match servers ship it.
+ */
+UCLASS()
+class UCyclopeReplayRelayCommandlet : public UCommandlet
+{
+	GENERATED_BODY()
+
+public:
+	UCyclopeReplayRelayCommandlet();
+
+	virtual int32 Main(const FString& Params) override;
+
+private:
+	bool HandleReplay(const FHttpServerRequest& Request, const FHttpResultCallback& OnComplete);
+	bool HandleEvent(const FHttpServerRequest& Request, const FHttpResultCallback& OnComplete);
+
+	void HandleList(const FHttpServerRequest& Request, const FHttpResultCallback& OnComplete);
+	void HandleStartUploading(const FString& SessionName, const FHttpServerRequest& Request,
+		const FHttpResultCallback& OnComplete);
+	void HandleFile(FCyclopeRelaySession& Session, const FString& FileName, const FHttpServerRequest& Request,
+		const FHttpResultCallback& OnComplete);
+	void HandleSessionEvents(FCyclopeRelaySession& Session, const FString& EventName,
+		const FHttpServerRequest& Request, const FHttpResultCallback& OnComplete);
+
+	TSharedPtr<FCyclopeRelaySession> FindSession(const FString& Name) const;
+
+	/** Log per session upload and fan-out rates since the last report **/
+	void ReportStats(double Interval);
+
+	/** Drop sessions nothing was uploaded to for SessionExpiry, once nobody watches them **/
+	void ExpireSessions();
+
+	TMap<FString, TSharedPtr<FCyclopeRelaySession>> Sessions;
+
+	/** Spectators not refreshing for this long stop counting as viewers **/
+	double ViewerTimeout;
+
+	/** Seconds a finished or abandoned session is kept for late spectators **/
+	double SessionExpiry;
+
+	int32 NextSessionId;
+	int32 NextViewerId;
+};